@@ -0,0 +1,66 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include "matrix.h"
+#include "transpositions.h"
+
+using namespace mt;
+
+// Return mean nanoseconds per element of two runs of f, so that an in-place
+// transposition ends with the original dimensions.
+template<typename Lambda>
+double time_per_element(const size_t elements, Lambda f) {
+	constexpr size_t repetition_count = 2;
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t j = 0; j < repetition_count; j++) {
+		f();
+	}
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / repetition_count / elements;
+}
+
+void measure(std::ofstream& ofs, const size_t height, const size_t width) {
+	matrix<int32_t> m(height, width), dst(width, height);
+	for (size_t j = 0; j < height * width; j++) {
+		m.to_array()[j] = int32_t(j);
+		dst.to_array()[j] = 0;
+	}
+	transposition_in_place<int32_t> tp(m);
+	const auto cycles = time_per_element(height * width, [&tp] { tp.transpose_cycles(); });
+	const auto cycles_bytes = tp.extra_memory();
+	const auto blocked = time_per_element(height * width, [&tp] { tp.transpose(); });
+	const auto blocked_bytes = tp.extra_memory();
+	const auto out_of_place = time_per_element(height * width, [&] { transpose_into(m, dst); });
+	const auto out_of_place_bytes = height * width * sizeof(int32_t);
+
+	std::cout << "H: " << height << " W: " << width << " Cycles: " << cycles << " Blocked: " << blocked;
+	std::cout << " OutOfPlace: " << out_of_place << " Bytes: " << cycles_bytes << " " << blocked_bytes << " " << out_of_place_bytes << std::endl;
+	ofs << height << " " << width << " " << cycles << " " << blocked << " " << out_of_place << " ";
+	ofs << cycles_bytes << " " << blocked_bytes << " " << out_of_place_bytes << std::endl << std::flush;
+}
+
+/*
+ * In-place transposition of rectangular matrices (plain and blocked cycle
+ * following) against the out-of-place one -- nanoseconds per element of 4
+ * bytes and bytes taken besides the matrix. Matrices have about
+ * exp2(2k / 9) elements, with widths 16, 96 and 100 and heights divisible
+ * by 32. Argument -- largest k.
+ */
+int main(int argc, char* argv[]) {
+	const size_t max_k = (argc > 1) ? std::stoul(argv[1]) : 117;
+
+	std::ofstream ofs{ "in_place.dat" };
+	ofs << "h w cycles blocked out_of_place cycles_bytes blocked_bytes out_of_place_bytes" << std::endl << std::flush;
+	for (size_t k = 54; k <= max_k; k += 9) {
+		const size_t dim = ceil(exp2(double(k) / 9));
+		for (size_t width : { 16, 96, 100 }) {
+			const size_t height = dim * dim / width / 32 * 32;
+			if (height > 0) {
+				measure(ofs, height, width);
+			}
+		}
+	}
+}
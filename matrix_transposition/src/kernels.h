@@ -0,0 +1,225 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MT_SSE2
+#include <immintrin.h>
+#endif
+#if defined(__AVX__)
+#define MT_AVX
+#endif
+
+namespace mt {
+	/*
+	 * Tile kernels transpose square tiles of tile x tile elements held in
+	 * registers. A tile is loaded from rows of a matrix with the given row
+	 * stride (in elements), transposed and stored elsewhere, so swapping two
+	 * tiles across the diagonal costs two loads and two stores of whole rows
+	 * instead of strided single element accesses.
+	 *
+	 * The generic kernel works for any type, trivially copyable types of 4
+	 * and 8 bytes are shuffled by SSE, or AVX when compiled for it.
+	 */
+	template <typename T, typename Enable = void>
+	struct tile_kernel {
+		static constexpr size_t tile = 8;
+
+		struct registers {
+			T v[tile][tile];
+		};
+
+		static void load(registers& r, const T* p, const size_t stride) {
+			for (size_t h = 0; h < tile; h++) {
+				for (size_t w = 0; w < tile; w++) {
+					r.v[h][w] = p[h * stride + w];
+				}
+			}
+		}
+
+		static void transpose(registers& r) {
+			for (size_t h = 1; h < tile; h++) {
+				for (size_t w = 0; w < h; w++) {
+					std::swap(r.v[h][w], r.v[w][h]);
+				}
+			}
+		}
+
+		static void store(const registers& r, T* p, const size_t stride) {
+			for (size_t h = 0; h < tile; h++) {
+				for (size_t w = 0; w < tile; w++) {
+					p[h * stride + w] = r.v[h][w];
+				}
+			}
+		}
+	};
+
+	template <typename T, size_t Size>
+	using if_simd_eligible = std::enable_if_t<std::is_trivially_copyable<T>::value && sizeof(T) == Size>;
+
+#if defined(MT_AVX)
+	// 8x8 tile of 4-byte elements in eight 256-bit registers.
+	template <typename T>
+	struct tile_kernel<T, if_simd_eligible<T, 4>> {
+		static constexpr size_t tile = 8;
+
+		struct registers {
+			__m256 v[tile];
+		};
+
+		static void load(registers& r, const T* p, const size_t stride) noexcept {
+			for (size_t h = 0; h < tile; h++) {
+				r.v[h] = _mm256_loadu_ps(reinterpret_cast<const float*>(p + h * stride));
+			}
+		}
+
+		// Interleave pairs of rows, then pairs of pairs, then exchange 128-bit halves.
+		static void transpose(registers& r) noexcept {
+			__m256 t[tile], u[tile];
+			for (size_t h = 0; h < tile; h += 2) {
+				t[h] = _mm256_unpacklo_ps(r.v[h], r.v[h + 1]);
+				t[h + 1] = _mm256_unpackhi_ps(r.v[h], r.v[h + 1]);
+			}
+			for (size_t h = 0; h < tile; h += 4) {
+				u[h] = _mm256_shuffle_ps(t[h], t[h + 2], _MM_SHUFFLE(1, 0, 1, 0));
+				u[h + 1] = _mm256_shuffle_ps(t[h], t[h + 2], _MM_SHUFFLE(3, 2, 3, 2));
+				u[h + 2] = _mm256_shuffle_ps(t[h + 1], t[h + 3], _MM_SHUFFLE(1, 0, 1, 0));
+				u[h + 3] = _mm256_shuffle_ps(t[h + 1], t[h + 3], _MM_SHUFFLE(3, 2, 3, 2));
+			}
+			for (size_t h = 0; h < 4; h++) {
+				r.v[h] = _mm256_permute2f128_ps(u[h], u[h + 4], 0x20);
+				r.v[h + 4] = _mm256_permute2f128_ps(u[h], u[h + 4], 0x31);
+			}
+		}
+
+		static void store(const registers& r, T* p, const size_t stride) noexcept {
+			for (size_t h = 0; h < tile; h++) {
+				_mm256_storeu_ps(reinterpret_cast<float*>(p + h * stride), r.v[h]);
+			}
+		}
+	};
+
+	// 4x4 tile of 8-byte elements in four 256-bit registers.
+	template <typename T>
+	struct tile_kernel<T, if_simd_eligible<T, 8>> {
+		static constexpr size_t tile = 4;
+
+		struct registers {
+			__m256d v[tile];
+		};
+
+		static void load(registers& r, const T* p, const size_t stride) noexcept {
+			for (size_t h = 0; h < tile; h++) {
+				r.v[h] = _mm256_loadu_pd(reinterpret_cast<const double*>(p + h * stride));
+			}
+		}
+
+		static void transpose(registers& r) noexcept {
+			const __m256d t0 = _mm256_unpacklo_pd(r.v[0], r.v[1]);
+			const __m256d t1 = _mm256_unpackhi_pd(r.v[0], r.v[1]);
+			const __m256d t2 = _mm256_unpacklo_pd(r.v[2], r.v[3]);
+			const __m256d t3 = _mm256_unpackhi_pd(r.v[2], r.v[3]);
+			r.v[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+			r.v[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+			r.v[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+			r.v[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+		}
+
+		static void store(const registers& r, T* p, const size_t stride) noexcept {
+			for (size_t h = 0; h < tile; h++) {
+				_mm256_storeu_pd(reinterpret_cast<double*>(p + h * stride), r.v[h]);
+			}
+		}
+	};
+#elif defined(MT_SSE2)
+	// 4x4 tile of 4-byte elements in four 128-bit registers.
+	template <typename T>
+	struct tile_kernel<T, if_simd_eligible<T, 4>> {
+		static constexpr size_t tile = 4;
+
+		struct registers {
+			__m128 v[tile];
+		};
+
+		static void load(registers& r, const T* p, const size_t stride) noexcept {
+			for (size_t h = 0; h < tile; h++) {
+				r.v[h] = _mm_loadu_ps(reinterpret_cast<const float*>(p + h * stride));
+			}
+		}
+
+		static void transpose(registers& r) noexcept {
+			_MM_TRANSPOSE4_PS(r.v[0], r.v[1], r.v[2], r.v[3]);
+		}
+
+		static void store(const registers& r, T* p, const size_t stride) noexcept {
+			for (size_t h = 0; h < tile; h++) {
+				_mm_storeu_ps(reinterpret_cast<float*>(p + h * stride), r.v[h]);
+			}
+		}
+	};
+
+	// 2x2 tile of 8-byte elements in two 128-bit registers.
+	template <typename T>
+	struct tile_kernel<T, if_simd_eligible<T, 8>> {
+		static constexpr size_t tile = 2;
+
+		struct registers {
+			__m128d v[tile];
+		};
+
+		static void load(registers& r, const T* p, const size_t stride) noexcept {
+			r.v[0] = _mm_loadu_pd(reinterpret_cast<const double*>(p));
+			r.v[1] = _mm_loadu_pd(reinterpret_cast<const double*>(p + stride));
+		}
+
+		static void transpose(registers& r) noexcept {
+			const __m128d t = _mm_unpacklo_pd(r.v[0], r.v[1]);
+			r.v[1] = _mm_unpackhi_pd(r.v[0], r.v[1]);
+			r.v[0] = t;
+		}
+
+		static void store(const registers& r, T* p, const size_t stride) noexcept {
+			_mm_storeu_pd(reinterpret_cast<double*>(p), r.v[0]);
+			_mm_storeu_pd(reinterpret_cast<double*>(p + stride), r.v[1]);
+		}
+	};
+#endif
+
+	// Transpose the tile at p in place.
+	template <typename T>
+	void transpose_tile(T* p, const size_t stride) {
+		using kernel = tile_kernel<T>;
+		typename kernel::registers r;
+		kernel::load(r, p, stride);
+		kernel::transpose(r);
+		kernel::store(r, p, stride);
+	}
+
+	// Store the transposition of the tile at src to dst.
+	template <typename T>
+	void transpose_tile_into(const T* src, const size_t src_stride, T* dst, const size_t dst_stride) {
+		using kernel = tile_kernel<T>;
+		typename kernel::registers r;
+		kernel::load(r, src, src_stride);
+		kernel::transpose(r);
+		kernel::store(r, dst, dst_stride);
+	}
+
+	// Store the transposition of the tile at a to b and vice versa.
+	template <typename T>
+	void swap_tiles(T* a, T* b, const size_t stride) {
+		using kernel = tile_kernel<T>;
+		typename kernel::registers ra, rb;
+		kernel::load(ra, a, stride);
+		kernel::load(rb, b, stride);
+		kernel::transpose(ra);
+		kernel::transpose(rb);
+		kernel::store(ra, b, stride);
+		kernel::store(rb, a, stride);
+	}
+}
+
+#endif /* KERNELS_HPP */
@@ -28,6 +28,10 @@ double std_err(std::vector<double>& v) {
 int main(int argc, char* argv[]) {
 	const auto simulate = true;
 	const auto debug = false;
+	// Rows padded to an odd number of cache lines on 2MB pages, against
+	// the power-of-two strides of the swept dimensions, measured in columns
+	// of their own next to the default storage.
+	const auto layout = storage::huge_page();
 
 	if (simulate) {
 		for (size_t i = 54; i <= 120; i++) {
@@ -38,11 +42,6 @@ int main(int argc, char* argv[]) {
 			const auto simulate_swap = [](const size_t h, const size_t w) {
 				std::cout << "X " << h << " " << w << " " << w << " " << h << std::endl;
 			};
-			const auto do_swap = [data = m.to_array(), dim](const size_t h, const size_t w) {
-				const auto temp = data[w * dim + h];
-				data[w * dim + h] = data[h * dim + w];
-				data[h * dim + w] = temp;
-			};
 
 			std::cout << "N " << dim << std::endl;
 			to.transpose(simulate_swap);
@@ -51,7 +50,8 @@ int main(int argc, char* argv[]) {
 	}
 	else {
 			std::ofstream ofs{ "results.dat" };
-			ofs << "k n naive naive_err oblivious oblivious_err" << std::endl << std::flush;
+			ofs << "k n naive naive_err oblivious oblivious_err simd simd_err";
+			ofs << " naive_huge naive_huge_err oblivious_huge oblivious_huge_err simd_huge simd_huge_err" << std::endl << std::flush;
 
 			constexpr size_t repetition_count = 10;
 
@@ -59,24 +59,38 @@ int main(int argc, char* argv[]) {
 			auto end = std::chrono::steady_clock::now();
 			std::vector<double> naive_values(repetition_count, 0.0);
 			std::vector<double> oblivious_values(repetition_count, 0.0);
+			std::vector<double> simd_values(repetition_count, 0.0);
+			std::vector<double> naive_huge_values(repetition_count, 0.0);
+			std::vector<double> oblivious_huge_values(repetition_count, 0.0);
+			std::vector<double> simd_huge_values(repetition_count, 0.0);
 
 			for (size_t i = 54; /* Till RAM runs out. */ ; i++) {
 				const size_t dim = ceil(exp2(double(i) / 9));
 				matrix<int32_t> m(dim, dim);
 				transposition_naive<int32_t> tn(m);
 				transposition_cache_oblivious<int32_t> to(m);
+				transposition_simd<int32_t> ts(m);
+				matrix<int32_t> mh(dim, dim, layout);
+				transposition_naive<int32_t> tnh(mh);
+				transposition_cache_oblivious<int32_t> toh(mh);
+				transposition_simd<int32_t> tsh(mh);
 				const auto simulate_swap = [](const size_t h, const size_t w) {
 					std::cout << "X " << h << " " << w << " " << w << " " << h << std::endl;
 				};
-				const auto do_swap = [data = m.to_array(), dim](const size_t h, const size_t w) {
-					const auto temp = data[w * dim + h];
-					data[w * dim + h] = data[h * dim + w];
-					data[h * dim + w] = temp;
+				const auto do_swap = [data = m.to_array(), stride = m.stride()](const size_t h, const size_t w) {
+					const auto temp = data[w * stride + h];
+					data[w * stride + h] = data[h * stride + w];
+					data[h * stride + w] = temp;
+				};
+				const auto do_swap_huge = [data = mh.to_array(), stride = mh.stride()](const size_t h, const size_t w) {
+					const auto temp = data[w * stride + h];
+					data[w * stride + h] = data[h * stride + w];
+					data[h * stride + w] = temp;
 				};
 
 				if (debug) {
 					for (size_t j = 0; j < dim * dim; j++) {
-						m.to_array()[j] = j;
+						m.get(j / dim, j % dim) = j;
 					}
 				}
 
@@ -114,16 +128,64 @@ int main(int argc, char* argv[]) {
 							}
 						}
 					}
+
+					start = std::chrono::steady_clock::now();
+					ts.transpose();
+					end = std::chrono::steady_clock::now();
+					time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / switch_count(dim);
+					simd_values[j] = time;
+
+					if (debug) {
+						for (size_t width = 0; width < dim; width++) {
+							for (size_t height = 0; height < dim; height++) {
+								if (size_t(m.at(height, width)) != width * dim + height) {
+									std::cout << "Err simd: " << i << " at (" << height << width << ") is " << m.at(height, width) << "should be " << width * dim + height << std::endl;
+								}
+							}
+						}
+						// Back to the original for the next repetition.
+						ts.transpose();
+					}
+
+					start = std::chrono::steady_clock::now();
+					tnh.transpose(do_swap_huge);
+					end = std::chrono::steady_clock::now();
+					naive_huge_values[j] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / switch_count(dim);
+
+					start = std::chrono::steady_clock::now();
+					toh.transpose(do_swap_huge);
+					end = std::chrono::steady_clock::now();
+					oblivious_huge_values[j] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / switch_count(dim);
+
+					start = std::chrono::steady_clock::now();
+					tsh.transpose();
+					end = std::chrono::steady_clock::now();
+					simd_huge_values[j] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / switch_count(dim);
 				}
 
 				const auto naive_mean = std::accumulate(naive_values.begin(), naive_values.end(), 0.0) / repetition_count;
 				const auto oblivious_mean = std::accumulate(oblivious_values.begin(), oblivious_values.end(), 0.0) / repetition_count;
+				const auto simd_mean = std::accumulate(simd_values.begin(), simd_values.end(), 0.0) / repetition_count;
 				const auto naive_err = std_err(naive_values);
 				const auto oblivious_err = std_err(oblivious_values);
+				const auto simd_err = std_err(simd_values);
+				const auto naive_huge_mean = std::accumulate(naive_huge_values.begin(), naive_huge_values.end(), 0.0) / repetition_count;
+				const auto oblivious_huge_mean = std::accumulate(oblivious_huge_values.begin(), oblivious_huge_values.end(), 0.0) / repetition_count;
+				const auto simd_huge_mean = std::accumulate(simd_huge_values.begin(), simd_huge_values.end(), 0.0) / repetition_count;
+				const auto naive_huge_err = std_err(naive_huge_values);
+				const auto oblivious_huge_err = std_err(oblivious_huge_values);
+				const auto simd_huge_err = std_err(simd_huge_values);
 
 				std::cout << "k: " << i << " N: " << dim << " Naive: " << naive_mean << " NaiveErr: " << naive_err;
-				std::cout << " Oblivious: " << oblivious_mean << " ObliviousErr: " << oblivious_err << std::endl;
-				ofs << i << " " << dim << " " << naive_mean << " " << naive_err << " " << oblivious_mean << " " << oblivious_err << std::endl << std::flush;
+				std::cout << " Oblivious: " << oblivious_mean << " ObliviousErr: " << oblivious_err;
+				std::cout << " Simd: " << simd_mean << " SimdErr: " << simd_err;
+				std::cout << " NaiveHuge: " << naive_huge_mean << " NaiveHugeErr: " << naive_huge_err;
+				std::cout << " ObliviousHuge: " << oblivious_huge_mean << " ObliviousHugeErr: " << oblivious_huge_err;
+				std::cout << " SimdHuge: " << simd_huge_mean << " SimdHugeErr: " << simd_huge_err << std::endl;
+				ofs << i << " " << dim << " " << naive_mean << " " << naive_err << " " << oblivious_mean << " " << oblivious_err;
+				ofs << " " << simd_mean << " " << simd_err;
+				ofs << " " << naive_huge_mean << " " << naive_huge_err << " " << oblivious_huge_mean << " " << oblivious_huge_err;
+				ofs << " " << simd_huge_mean << " " << simd_huge_err << std::endl << std::flush;
 			}
 	}
 }
\ No newline at end of file
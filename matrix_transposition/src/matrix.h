@@ -2,85 +2,298 @@
 #define MATRIX_HPP
 
 #include <exception>
+#include <stdexcept>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <cstdlib>
+#include <new>
 #include <ostream>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 #define CHECK(height,width) \
 if (height < 0 || width < 0 || size_t(height) >= height_ || size_t(width) >= width_) \
-	throw std::exception("At least one of the input coordinates is out of bounds.");
+	throw std::out_of_range("At least one of the input coordinates is out of bounds.");
 
 namespace mt {
 	/*
-	 * Simple matrix class implementation. The data are stored in row-major order.
-	 * Basic operations always share underlying data. For deep copy, the caller must
-	 * use copy() (for exact behavior refer to its implementation).
+	 * How matrix data are allocated. Rows are stride() elements apart, the
+	 * buffer starts at a multiple of alignment bytes. With power-of-two row
+	 * lengths, elements of one column map to the same few cache sets and
+	 * transposition keeps evicting its own lines. Padding makes every row
+	 * an odd number of cache lines long, so columns spread over all sets.
+	 */
+	struct storage {
+		static constexpr size_t cache_line = 64;
+		static constexpr size_t huge_page_size = size_t(2) << 20;
+
+		// Alignment of the buffer in bytes, a power of two.
+		size_t alignment;
+		// Advise the system to back the buffer by 2MB pages (Linux only).
+		bool huge_pages;
+		// Pad rows to an odd number of cache lines.
+		bool pad;
+
+		// Like new T[], rows are not padded.
+		static storage standard() noexcept { return { alignof(std::max_align_t), false, false }; }
+
+		static storage cache_aligned(const bool pad = true) noexcept { return { cache_line, false, pad }; }
+
+		static storage huge_page(const bool pad = true) noexcept { return { huge_page_size, true, pad }; }
+
+		// Return row stride in elements for rows of width elements of element_size bytes.
+		size_t stride(const size_t width, const size_t element_size) const noexcept {
+			if (!pad || cache_line % element_size) {
+				return width;
+			}
+			auto lines = (width * element_size + cache_line - 1) / cache_line;
+			if (lines % 2 == 0) {
+				lines++;
+			}
+			return lines * cache_line / element_size;
+		}
+
+		void* allocate(size_t bytes) const {
+			const auto align = std::max(alignment, alignof(std::max_align_t));
+			if (huge_pages) {
+				bytes = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+			}
+#if defined(_MSC_VER)
+			void* p = _aligned_malloc(bytes, align);
+#else
+			void* p = nullptr;
+			if (posix_memalign(&p, align, bytes)) {
+				p = nullptr;
+			}
+#endif
+			if (!p) {
+				throw std::bad_alloc();
+			}
+#if defined(MADV_HUGEPAGE)
+			if (huge_pages) {
+				madvise(p, bytes, MADV_HUGEPAGE);
+			}
+#endif
+			return p;
+		}
+
+		static void deallocate(void* p) noexcept {
+#if defined(_MSC_VER)
+			_aligned_free(p);
+#else
+			free(p);
+#endif
+		}
+	};
+
+	/*
+	 * Non-owning window into matrix data -- height x width elements, rows
+	 * stride() elements apart, starting at row() and column() of the
+	 * matrix the view was made from. Views are cheap to copy and
+	 * submatrix() makes a smaller one in O(1), so algorithms can recurse on
+	 * them. A view must not outlive its matrix. T may be const.
+	 */
+	template <typename T>
+	class matrix_view {
+		T* data_;
+		size_t height_;
+		size_t width_;
+		size_t stride_;
+		size_t row_;
+		size_t column_;
+
+		template <typename U>
+		friend class matrix_view;
+
+	public:
+		matrix_view() noexcept : data_(nullptr), height_(0), width_(0), stride_(0), row_(0), column_(0) {}
+
+		matrix_view(T* data, const size_t height, const size_t width, const size_t stride,
+			const size_t row = 0, const size_t column = 0) noexcept :
+			data_(data), height_(height), width_(width), stride_(stride), row_(row), column_(column) {}
+
+		// View of mutable elements is a view of const ones as well.
+		template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+		matrix_view(const matrix_view<U>& other) noexcept :
+			data_(other.data_), height_(other.height_), width_(other.width_), stride_(other.stride_),
+			row_(other.row_), column_(other.column_) {}
+
+		// Return indexed element. No bound checking -- outside of bounds
+		// causes undefined behavior.
+		T& get(const size_t height, const size_t width) const noexcept {
+			return data_[height * stride_ + width];
+		}
+
+		// Return indexed element. Throw std::out_of_range in case of wrong bounds.
+		T& at(const int_least32_t height, const int_least32_t width) const {
+			CHECK(height, width);
+			return get(height, width);
+		}
+
+		// Return view of h x w elements starting at row r and column c of
+		// this view. Throw std::out_of_range when it does not fit.
+		matrix_view submatrix(const size_t r, const size_t c, const size_t h, const size_t w) const {
+			if (r + h > height_ || c + w > width_) {
+				throw std::out_of_range("Submatrix is out of bounds.");
+			}
+			return subview(r, c, h, w);
+		}
+
+		// Return the same as submatrix without bound checking, so that it
+		// inlines into recursions, which only split views they already have.
+		matrix_view subview(const size_t r, const size_t c, const size_t h, const size_t w) const noexcept {
+			return matrix_view(data_ + r * stride_ + c, h, w, stride_, row_ + r, column_ + c);
+		}
+
+		size_t height() const noexcept { return height_; }
+
+		size_t width() const noexcept { return width_; }
+
+		size_t stride() const noexcept { return stride_; }
+
+		// Return row of the matrix where the view starts.
+		size_t row() const noexcept { return row_; }
+
+		// Return column of the matrix where the view starts.
+		size_t column() const noexcept { return column_; }
+
+		bool contiguous() const noexcept { return stride_ == width_; }
+
+		// Return pointer to the first element.
+		T* to_array() const noexcept { return data_; }
+	};
+
+	template <typename T>
+	class transposition_in_place;
+
+	/*
+	 * Simple matrix class implementation. The data are stored in row-major order,
+	 * rows are stride() elements apart (see storage).
+	 * The matrix owns its data, copies are deep (for exact behavior refer to
+	 * copy()). To share the data, use view() or submatrix().
 	 */
 	template <typename T>
 	class matrix {
 		T* data_;
 		size_t height_;
 		size_t width_;
+		size_t stride_;
+		storage storage_;
+
+		void allocate() {
+			const auto count = height_ * stride_;
+			data_ = static_cast<T*>(storage_.allocate(sizeof(T) * count));
+			for (size_t i = 0; i < count; i++) {
+				new (data_ + i) T;
+			}
+		}
+
+		void release() noexcept {
+			if (data_) {
+				if (!std::is_trivially_destructible<T>::value) {
+					for (size_t i = 0; i < height_ * stride_; i++) {
+						data_[i].~T();
+					}
+				}
+				storage::deallocate(data_);
+				data_ = nullptr;
+			}
+		}
+
+		// Exchange height and width, the data stay as they are. Only for
+		// in-place transposition of contiguous matrices, padded rows would
+		// not keep their stride.
+		friend class transposition_in_place<T>;
+		void swap_dimensions() noexcept {
+			std::swap(height_, width_);
+			stride_ = width_;
+		}
 
 	public:
-		matrix() noexcept : data_(nullptr), height_(0), width_(0) {}
+		matrix() noexcept : data_(nullptr), height_(0), width_(0), stride_(0), storage_(storage::standard()) {}
 
 		// Instantiate matrix with predefined dimensions filled with random data.
-		matrix(const int_least32_t height, const int_least32_t width) {
+		matrix(const int_least32_t height, const int_least32_t width, const storage& s = storage::standard()) :
+			data_(nullptr), storage_(s) {
 			if (height > 0 && width > 0) {
-				data_ = new T[height * width];
 				height_ = height;
 				width_ = width;
+				stride_ = s.stride(width_, sizeof(T));
+				allocate();
 			}
 			else {
-				throw std::exception("At least on of matrix input parameters is less than one.");
+				throw std::invalid_argument("At least on of matrix input parameters is less than one.");
 			}
 		}
 
-		// Shares matrix data.
+		// Copies matrix data, allocated the same way.
 		matrix(const matrix& other) :
-			data_{ other.data_ }, height_(other.height_), width_(other.width_) {}
+			data_(nullptr), height_(other.height_), width_(other.width_), stride_(other.stride_),
+			storage_(other.storage_) {
+			if (other.data_) {
+				allocate();
+				for (size_t row = 0; row < height_; row++) {
+					std::copy(other.data_ + row * stride_, other.data_ + row * stride_ + width_, data_ + row * stride_);
+				}
+			}
+		}
 
-		// Shares matrix data.
-		matrix& operator=(const matrix& other) noexcept {
+		// Copies matrix data.
+		matrix& operator=(const matrix& other) {
 			if (this == &other)
 				return *this;
-			data_ = other.data_;
-			height_ = other.height_;
-			width_ = other.width_;
+			matrix temp(other);
+			swap(temp);
 			return *this;
 		}
 
-		matrix(matrix&& other) noexcept :
-			data_{ std::move(other.data_) }, height_(other.height_), width_(other.width_) {}
+		// Takes the data over, other is left empty.
+		matrix(matrix&& other) noexcept : matrix() {
+			swap(other);
+		}
 
 		matrix& operator=(matrix&& other) noexcept {
 			if (this == &other)
 				return *this;
-			data_ = std::move(other.data_);
-			height_ = other.height_;
-			width_ = other.width_;
+			release();
+			height_ = width_ = stride_ = 0;
+			swap(other);
 			return *this;
 		}
 
+		void swap(matrix& other) noexcept {
+			std::swap(data_, other.data_);
+			std::swap(height_, other.height_);
+			std::swap(width_, other.width_);
+			std::swap(stride_, other.stride_);
+			std::swap(storage_, other.storage_);
+		}
+
 		// Return zeroed-out matrix with defined dimensions.
-		static matrix zeros(const int_least32_t height, const int_least32_t width) {
-			matrix m(height, width);
-			std::memset(m.to_array(), 0, sizeof(T) * width * height);
-			return std::move(m);
+		static matrix zeros(const int_least32_t height, const int_least32_t width, const storage& s = storage::standard()) {
+			matrix m(height, width, s);
+			std::memset(m.to_array(), 0, sizeof(T) * m.stride() * height);
+			return m;
 		}
 
 		// Return indexed matrix element. No bound checking -- outside of bounds
 		// causes undefined behavior.
 		T& get(const int_least32_t height, const int_least32_t width) noexcept {
-			return data_[height * width_ + width];
+			return data_[height * stride_ + width];
 		}
 
 		const T& get(const int_least32_t height, const int_least32_t width) const noexcept {
-			return data_[height * width_ + width];
+			return data_[height * stride_ + width];
 		}
 
-		// Return indexed element. Throw std::exception in case of wrong bounds.
+		// Return indexed element. Throw std::out_of_range in case of wrong bounds.
 		T& at(const int_least32_t height, const int_least32_t width) {
 			CHECK(height, width);
 			return get(height, width);
@@ -91,21 +304,44 @@ namespace mt {
 			return get(height, width);
 		}
 
+		// Return view of the whole matrix.
+		matrix_view<T> view() noexcept {
+			return matrix_view<T>(data_, height_, width_, stride_);
+		}
+
+		matrix_view<const T> view() const noexcept {
+			return matrix_view<const T>(data_, height_, width_, stride_);
+		}
+
+		operator matrix_view<T>() noexcept { return view(); }
+
+		operator matrix_view<const T>() const noexcept { return view(); }
+
+		// Return view of h x w elements starting at row r and column c, in O(1).
+		matrix_view<T> submatrix(const size_t r, const size_t c, const size_t h, const size_t w) {
+			return view().submatrix(r, c, h, w);
+		}
+
+		matrix_view<const T> submatrix(const size_t r, const size_t c, const size_t h, const size_t w) const {
+			return view().submatrix(r, c, h, w);
+		}
+
 		// Return height of the matrix.
 		size_t height() const noexcept { return height_; }
 
 		// Return width of the matrix.
 		size_t width() const noexcept { return width_; }
 
-		// Return copy of the matrix. Exact behavior depends on
-		// T& operator(const T&) making it deep or shallow copy.
+		// Return distance of rows in elements, at least width().
+		size_t stride() const noexcept { return stride_; }
+
+		// Return whether rows follow each other without padding.
+		bool contiguous() const noexcept { return stride_ == width_; }
+
+		// Return copy of the matrix, allocated the same way. Exact behavior
+		// depends on T& operator(const T&) making it deep or shallow copy.
 		matrix copy() const {
-			matrix temp = matrix(height_, width_);
-			auto err = memcpy_s(temp.to_array(), height_ * width_, data_, height_ * width_);
-			if (err) {
-				std::exception("Problem");
-			}
-			return std::move(temp);
+			return matrix(*this);
 		}
 
 		// Return underlying const pointer to matrix data.
@@ -124,7 +360,7 @@ namespace mt {
 		}
 
 		~matrix() {
-			delete[] data_;
+			release();
 		}
 	};
 }
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include "matrix.h"
+#include "transpositions.h"
+
+using namespace mt;
+
+// Return mean nanoseconds per element of repetition_count runs of f.
+template<typename Lambda>
+double time_per_element(const size_t elements, Lambda f) {
+	constexpr size_t repetition_count = 5;
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t j = 0; j < repetition_count; j++) {
+		f();
+	}
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / repetition_count / elements;
+}
+
+void measure(std::ofstream& ofs, const size_t height, const size_t width) {
+	matrix<int32_t> src(height, width), dst(width, height);
+	// Touch all pages of both, so that page faults do not count.
+	for (size_t j = 0; j < height * width; j++) {
+		src.to_array()[j] = int32_t(j);
+		dst.to_array()[j] = 0;
+	}
+	auto in_place = std::numeric_limits<double>::quiet_NaN();
+	if (height == width) {
+		transposition_simd<int32_t> ts(src);
+		in_place = time_per_element(height * width, [&ts] { ts.transpose(); });
+	}
+	const auto oblivious = time_per_element(height * width, [&] { transpose_into(src, dst); });
+	const auto tiled = time_per_element(height * width, [&] { transpose_into_tiled(src, dst); });
+
+	std::cout << "H: " << height << " W: " << width << " InPlace: " << in_place;
+	std::cout << " Oblivious: " << oblivious << " Tiled: " << tiled << std::endl;
+	ofs << height << " " << width << " " << in_place << " " << oblivious << " " << tiled << std::endl << std::flush;
+}
+
+/*
+ * Out-of-place transposition (cache oblivious and tiled) against the
+ * in-place square one, in nanoseconds per element of 4 bytes. Square
+ * matrices of dimension exp2(k / 9) first, then tall and skinny ones of
+ * the same element count. Argument -- largest k.
+ */
+int main(int argc, char* argv[]) {
+	const size_t max_k = (argc > 1) ? std::stoul(argv[1]) : 117;
+
+	std::ofstream ofs{ "out_of_place.dat" };
+	ofs << "h w in_place oblivious tiled" << std::endl << std::flush;
+	for (size_t k = 54; k <= max_k; k += 3) {
+		const size_t dim = ceil(exp2(double(k) / 9));
+		measure(ofs, dim, dim);
+	}
+	for (size_t k = 54; k <= max_k; k += 3) {
+		const size_t dim = ceil(exp2(double(k) / 9));
+		for (size_t width : { 3, 16, 100 }) {
+			if (width < dim) {
+				measure(ofs, dim * dim / width, width);
+			}
+		}
+	}
+}
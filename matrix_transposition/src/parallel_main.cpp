@@ -0,0 +1,78 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include "matrix.h"
+#include "transpositions.h"
+
+using namespace mt;
+
+double mean(const std::vector<double>& v) {
+	return std::accumulate(v.begin(), v.end(), 0.0) / v.size();
+}
+
+double std_err(const std::vector<double>& v) {
+	const auto m = mean(v);
+	auto sq_sum = 0.0;
+	for (const auto x : v) {
+		sq_sum += (x - m) * (x - m);
+	}
+	return std::sqrt(sq_sum / v.size());
+}
+
+// Time transposition of one matrix of dimension exp2(k / 9) by 1, 2, 4, ... threads.
+template<typename T>
+void measure(std::ofstream& ofs, const size_t k, const unsigned max_threads) {
+	constexpr size_t repetition_count = 5;
+	const size_t dim = ceil(exp2(double(k) / 9));
+	matrix<T> m(dim, dim);
+	for (size_t j = 0; j < dim * dim; j++) {
+		m.to_array()[j] = T(j);
+	}
+	double serial = 0;
+	std::vector<double> values(repetition_count, 0.0);
+	for (unsigned threads = 1; ; threads = std::min(2 * threads, max_threads)) {
+		work_stealing_pool pool(threads);
+		transposition_simd<T> tp(m, pool);
+		for (size_t j = 0; j < repetition_count; j++) {
+			const auto start = std::chrono::steady_clock::now();
+			tp.transpose();
+			const auto end = std::chrono::steady_clock::now();
+			values[j] = std::chrono::duration<double>(end - start).count();
+		}
+		const auto time = mean(values);
+		if (threads == 1) {
+			serial = time;
+		}
+		std::cout << "B: " << sizeof(T) << " k: " << k << " N: " << dim << " Threads: " << threads;
+		std::cout << " Time: " << time << " Speedup: " << serial / time << std::endl;
+		ofs << sizeof(T) << " " << k << " " << dim << " " << threads << " " << time << " " << std_err(values);
+		ofs << " " << serial / time << std::endl << std::flush;
+		if (threads == max_threads) {
+			break;
+		}
+	}
+}
+
+/*
+ * Scaling of the parallel cache oblivious transposition with the thread
+ * count and the dimension, on 4-byte and 8-byte elements. Arguments --
+ * largest k (dimension exp2(k / 9)) and largest thread count.
+ */
+int main(int argc, char* argv[]) {
+	const size_t max_k = (argc > 1) ? std::stoul(argv[1]) : 117;
+	const unsigned max_threads = (argc > 2) ? unsigned(std::stoul(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+
+	std::ofstream ofs{ "parallel.dat" };
+	ofs << "bytes k n threads time time_err speedup" << std::endl << std::flush;
+	for (size_t k = 90; k <= max_k; k += 3) {
+		measure<int32_t>(ofs, k, max_threads);
+		measure<int64_t>(ofs, k, max_threads);
+	}
+}
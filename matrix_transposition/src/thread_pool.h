@@ -0,0 +1,163 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mt {
+	/*
+	 * Fork-join thread pool with work stealing. Every thread has its own
+	 * deque of tasks, it pushes and takes forked tasks at the back (depth
+	 * first, the data of the newest task is likely in its cache), idle
+	 * threads steal from the front of the others (the oldest and largest
+	 * pieces of the recursion). A thread waiting for its forked tasks runs
+	 * tasks meanwhile, so nested forks never deadlock and the thread calling
+	 * invoke from outside counts as one of thread_count() threads.
+	 */
+	class work_stealing_pool {
+		struct task {
+			std::function<void()> f;
+			std::atomic<size_t>* pending;
+		};
+
+		struct task_deque {
+			std::mutex lock;
+			std::deque<task> tasks;
+		};
+
+		// Deque of each worker, the last one is shared by threads outside of the pool.
+		std::vector<task_deque> deques_;
+		std::vector<std::thread> workers_;
+		std::atomic<size_t> queued_;
+		std::atomic<bool> stop_;
+		std::mutex sleep_lock_;
+		std::condition_variable wake_;
+
+		// Pool and deque of the calling thread, when it is a worker.
+		static work_stealing_pool*& current_pool() noexcept {
+			static thread_local work_stealing_pool* pool = nullptr;
+			return pool;
+		}
+
+		static size_t& current_index() noexcept {
+			static thread_local size_t index = 0;
+			return index;
+		}
+
+		size_t own_index() const noexcept {
+			return (current_pool() == this) ? current_index() : deques_.size() - 1;
+		}
+
+		void push(const size_t index, task&& t) {
+			{
+				std::lock_guard<std::mutex> guard(deques_[index].lock);
+				deques_[index].tasks.push_back(std::move(t));
+				++queued_;
+			}
+			// A worker checks queued_ under the lock before it sleeps, so it cannot miss the wake up.
+			{
+				std::lock_guard<std::mutex> guard(sleep_lock_);
+			}
+			wake_.notify_one();
+		}
+
+		// Take the newest own task or steal the oldest task of another thread.
+		bool take(const size_t index, task& t) {
+			for (size_t i = 0; i < deques_.size(); i++) {
+				auto& d = deques_[(index + i) % deques_.size()];
+				std::lock_guard<std::mutex> guard(d.lock);
+				if (!d.tasks.empty()) {
+					if (i == 0) {
+						t = std::move(d.tasks.back());
+						d.tasks.pop_back();
+					}
+					else {
+						t = std::move(d.tasks.front());
+						d.tasks.pop_front();
+					}
+					--queued_;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static void execute(task& t) {
+			t.f();
+			--*t.pending;
+		}
+
+		void work(const size_t index) {
+			current_pool() = this;
+			current_index() = index;
+			task t;
+			while (!stop_) {
+				if (take(index, t)) {
+					execute(t);
+				}
+				else {
+					std::unique_lock<std::mutex> guard(sleep_lock_);
+					wake_.wait(guard, [this] { return stop_ || queued_ > 0; });
+				}
+			}
+		}
+
+		template<typename Lambda>
+		void fork(const size_t index, std::atomic<size_t>& pending, Lambda&& f) {
+			push(index, task{ std::forward<Lambda>(f), &pending });
+		}
+
+	public:
+		// Pool of thread_count threads, the one calling invoke included.
+		explicit work_stealing_pool(unsigned thread_count = std::thread::hardware_concurrency()) :
+			deques_(thread_count > 1 ? thread_count : 1), queued_(0), stop_(false) {
+			for (size_t i = 0; i + 1 < deques_.size(); i++) {
+				workers_.emplace_back(&work_stealing_pool::work, this, i);
+			}
+		}
+
+		work_stealing_pool(const work_stealing_pool& other) = delete;
+		work_stealing_pool& operator=(const work_stealing_pool& other) = delete;
+
+		~work_stealing_pool() {
+			{
+				std::lock_guard<std::mutex> guard(sleep_lock_);
+				stop_ = true;
+			}
+			wake_.notify_all();
+			for (auto& w : workers_) {
+				w.join();
+			}
+		}
+
+		// Return number of threads working on tasks.
+		unsigned thread_count() const noexcept { return unsigned(deques_.size()); }
+
+		// Run all lambdas, possibly in parallel, and return when all of them
+		// have finished. The first one runs on the calling thread.
+		template<typename Lambda, typename... Lambdas>
+		void invoke(Lambda&& first, Lambdas&&... rest) {
+			const auto index = own_index();
+			std::atomic<size_t> pending(sizeof...(rest));
+			int expand[] = { 0, (fork(index, pending, std::forward<Lambdas>(rest)), 0)... };
+			(void)expand;
+			first();
+			task t;
+			while (pending > 0) {
+				if (take(index, t)) {
+					execute(t);
+				}
+				else {
+					std::this_thread::yield();
+				}
+			}
+		}
+	};
+}
+
+#endif /* THREAD_POOL_HPP */
@@ -2,11 +2,27 @@
 #define TRANSPOSITIONS_HPP
 
 #include <fstream>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include <stdexcept>
 #include "matrix.h"
+#include "kernels.h"
+#include "thread_pool.h"
 
 #define CHECK_IF_SQUARE(matrix) \
 if (matrix.width() != matrix.height()) { \
-	throw std::exception("Input matrix is not square."); \
+	throw std::invalid_argument("Input matrix is not square."); \
+}
+
+#define CHECK_IF_CONTIGUOUS(matrix) \
+if (!matrix.contiguous()) { \
+	throw std::invalid_argument("Input matrix has padded rows."); \
+}
+
+#define CHECK_IF_TRANSPOSED(src, dst) \
+if (src.height() != dst.width() || src.width() != dst.height()) { \
+	throw std::invalid_argument("Output matrix does not have transposed dimensions."); \
 }
 
 
@@ -40,27 +56,28 @@ namespace mt {
 		}
 
 		// Lambdas serve as a way how to split work with simulation and real switching at once.
+		// They get coordinates of elements in m.
 		template<typename Lambda>
 		void transpose(Lambda f) {
-			transpose_on_diagonal(0, 0, m.height(), m.width(), f);
+			transpose_on_diagonal(m.view(), f);
 		}
 	private:
 		// If the matrix is small enough we use naive algorithm, otherwise
 		// we use recursion.
 		template<typename Lambda>
-		matrix<T>& transpose_on_diagonal(size_t rb, size_t cb, size_t re, size_t ce, Lambda f) {
-			const auto r = re - rb, c = ce - cb;
+		matrix<T>& transpose_on_diagonal(const matrix_view<T>& d, Lambda f) {
+			const auto r = d.height(), c = d.width();
 			if (r <= 16 && c <= 16) {
-				for (auto h = rb; h < re; h++) {
-					for (auto w = cb; w < h; w++) {
-						f(h, w);
+				for (size_t h = 0; h < r; h++) {
+					for (size_t w = 0; w < h; w++) {
+						f(d.row() + h, d.column() + w);
 					}
 				}
 			}
 			else {
-				transpose_on_diagonal(rb, cb, rb + r / 2, cb + c / 2, f);
-				transpose_on_diagonal(rb + r / 2, cb + c / 2, re, ce, f);
-				transpose_and_swap(rb + r / 2, cb, re, cb + c / 2, f);
+				transpose_on_diagonal(d.subview(0, 0, r / 2, c / 2), f);
+				transpose_on_diagonal(d.subview(r / 2, c / 2, r - r / 2, c - c / 2), f);
+				transpose_and_swap(d.subview(r / 2, 0, r - r / 2, c / 2), f);
 			}
 			return m;
 		}
@@ -70,24 +87,345 @@ namespace mt {
 		// columns of the second matrix, which coordinates we compute from the
 		// coordinates of the first one.
 		template<typename Lambda>
-		matrix<T>& transpose_and_swap(size_t arb, size_t acb, size_t are, size_t ace, Lambda f) {
-			const auto ar = are - arb, ac = ace - acb;
+		matrix<T>& transpose_and_swap(const matrix_view<T>& a, Lambda f) {
+			const auto ar = a.height(), ac = a.width();
 			if (ar <= 16 || ac <= 16) {
 				for (size_t h = 0; h < ar; h++) {
 					for (size_t w = 0; w < ac; w++) {
-						f(arb + h, acb + w);
+						f(a.row() + h, a.column() + w);
 					}
 				}
 			}
 			else {
-				transpose_and_swap(arb, acb, arb + ar / 2, acb + ac / 2, f); // left top and  left top
-				transpose_and_swap(arb, acb + ac / 2, arb + ar / 2, ace, f); // right top and left bottom
-				transpose_and_swap(arb + ar / 2, acb, are, acb + ac / 2, f); // left bottom and right top
-				transpose_and_swap(arb + ar / 2, acb + ac / 2, are, ace, f); // right bottom and right bottom
+				transpose_and_swap(a.subview(0, 0, ar / 2, ac / 2), f); // left top and  left top
+				transpose_and_swap(a.subview(0, ac / 2, ar / 2, ac - ac / 2), f); // right top and left bottom
+				transpose_and_swap(a.subview(ar / 2, 0, ar - ar / 2, ac / 2), f); // left bottom and right top
+				transpose_and_swap(a.subview(ar / 2, ac / 2, ar - ar / 2, ac - ac / 2), f); // right bottom and right bottom
 			}
 			return m;
 		}
 	};
+
+	/*
+	 * Cache oblivious transposition that swaps data itself instead of calling
+	 * a lambda per element. The recursion works on whole tiles of the tile
+	 * kernel, blocks of 16x16 elements are transposed by swapping tile pairs
+	 * across the diagonal in registers. Rows and columns left over by the
+	 * tiles are swapped one element at a time. Any square view works, so a
+	 * block of a larger matrix can be transposed in place of itself.
+	 *
+	 * Given a pool, blocks with sides longer than cutoff elements are split
+	 * into fork-join tasks -- the two diagonal halves and the swap below
+	 * them, or the four quadrant swaps. None of them touch the same
+	 * elements.
+	 */
+	template<typename T>
+	class transposition_simd {
+	public:
+		matrix_view<T> m;
+		explicit transposition_simd(const matrix_view<T> mm) : m(mm), pool_(nullptr), cutoff_(0) {
+			CHECK_IF_SQUARE(m);
+		}
+
+		transposition_simd(const matrix_view<T> mm, work_stealing_pool& pool, const size_t cutoff = 256) :
+			m(mm), pool_(&pool), cutoff_(cutoff) {
+			CHECK_IF_SQUARE(m);
+		}
+
+		void transpose() {
+			const size_t tiled = m.height() / tile * tile;
+			transpose_on_diagonal(m.subview(0, 0, tiled, tiled));
+			for (size_t h = tiled; h < m.height(); h++) {
+				for (size_t w = 0; w < h; w++) {
+					std::swap(m.get(h, w), m.get(w, h));
+				}
+			}
+		}
+	private:
+		static constexpr size_t tile = tile_kernel<T>::tile;
+		// Side of the base case.
+		static constexpr size_t block = (tile < 16) ? 16 : tile;
+
+		work_stealing_pool* pool_;
+		// Longest side done by a single task.
+		size_t cutoff_;
+
+		bool parallel(const size_t r, const size_t c) const noexcept {
+			return pool_ && (r > cutoff_ || c > cutoff_);
+		}
+
+		// Half of side rounded to whole tiles.
+		static size_t half(const size_t side) noexcept {
+			return side / tile / 2 * tile;
+		}
+
+		// View d lies on the diagonal, its side is a multiple of tile.
+		void transpose_on_diagonal(const matrix_view<T>& d) {
+			const auto n = d.height();
+			if (n <= block) {
+				for (size_t h = 0; h < n; h += tile) {
+					transpose_tile(&d.get(h, h), d.stride());
+					for (size_t w = 0; w < h; w += tile) {
+						swap_tiles(&d.get(h, w), &d.get(w, h), d.stride());
+					}
+				}
+			}
+			else {
+				const auto k = half(n);
+				const auto top = d.subview(0, 0, k, k), bottom = d.subview(k, k, n - k, n - k);
+				const auto below = d.subview(k, 0, n - k, k), above = d.subview(0, k, k, n - k);
+				if (parallel(n, n)) {
+					pool_->invoke(
+						[=] { transpose_on_diagonal(top); },
+						[=] { transpose_on_diagonal(bottom); },
+						[=] { transpose_and_swap(below, above); });
+				}
+				else {
+					transpose_on_diagonal(top);
+					transpose_on_diagonal(bottom);
+					transpose_and_swap(below, above);
+				}
+			}
+		}
+
+		// Store the transposition of a to b and vice versa, b lies where a
+		// mirrors over the diagonal. Sides are multiples of tile.
+		void transpose_and_swap(const matrix_view<T>& a, const matrix_view<T>& b) {
+			const auto ar = a.height(), ac = a.width();
+			if (ar <= block || ac <= block) {
+				for (size_t h = 0; h < ar; h += tile) {
+					for (size_t w = 0; w < ac; w += tile) {
+						swap_tiles(&a.get(h, w), &b.get(w, h), a.stride());
+					}
+				}
+				return;
+			}
+			const auto hr = half(ar), hc = half(ac);
+			const matrix_view<T> as[] = {
+				a.subview(0, 0, hr, hc), a.subview(0, hc, hr, ac - hc),
+				a.subview(hr, 0, ar - hr, hc), a.subview(hr, hc, ar - hr, ac - hc) };
+			const matrix_view<T> bs[] = {
+				b.subview(0, 0, hc, hr), b.subview(hc, 0, ac - hc, hr),
+				b.subview(0, hr, hc, ar - hr), b.subview(hc, hr, ac - hc, ar - hr) };
+			if (parallel(ar, ac)) {
+				pool_->invoke(
+					[=] { transpose_and_swap(as[0], bs[0]); },
+					[=] { transpose_and_swap(as[1], bs[1]); },
+					[=] { transpose_and_swap(as[2], bs[2]); },
+					[=] { transpose_and_swap(as[3], bs[3]); });
+			}
+			else {
+				for (size_t i = 0; i < 4; i++) {
+					transpose_and_swap(as[i], bs[i]);
+				}
+			}
+		}
+	};
+
+	/*
+	 * In-place transposition of a matrix of any dimensions, height and width
+	 * of the matrix are exchanged as well. Element at position p of the
+	 * data goes to position p * height mod (size - 1), the permutation is
+	 * done cycle by cycle. Visited positions are marked in a bit vector,
+	 * which takes size / 8 bytes.
+	 *
+	 * Plain cycle following moves one element at a time to an unrelated
+	 * place and so misses the cache on almost every element. The blocked
+	 * variant moves whole rows of b x b blocks, b being a common divisor of
+	 * the dimensions, in four steps:
+	 *   1. in each band of b rows, put the b-long pieces of rows of one block
+	 *      together (each band is a b x width/b matrix of pieces),
+	 *   2. transpose every block,
+	 *   3. permute the blocks as elements of a height/b x width/b matrix,
+	 *   4. in each band of b rows of the result, put the pieces of one row
+	 *      together (each band is a height/b x b matrix of pieces).
+	 * Every step is cycle following on pieces of at least b elements.
+	 *
+	 * Padded rows would change their length with the dimensions, so the
+	 * matrix must be contiguous.
+	 */
+	template<typename T>
+	class transposition_in_place {
+	public:
+		matrix<T>& m;
+		explicit transposition_in_place(matrix<T>& mm) : m(mm), extra_memory_(0) {
+			CHECK_IF_CONTIGUOUS(m);
+		}
+
+		// Blocked variant, plain cycle following when the dimensions have
+		// no common divisor of at least 4.
+		void transpose() {
+			const auto b = block_size(m.height(), m.width());
+			if (b < 4) {
+				transpose_cycles();
+				return;
+			}
+			const auto h = m.height(), w = m.width(), mb = h / b, nb = w / b;
+			T* data = m.to_array();
+			extra_memory_ = 0;
+			for (size_t band = 0; band < mb; band++) {
+				permute(data + band * b * w, b, nb, b);
+			}
+			for (size_t block = 0; block < mb * nb; block++) {
+				T* p = data + block * b * b;
+				for (size_t r = 1; r < b; r++) {
+					for (size_t c = 0; c < r; c++) {
+						std::swap(p[r * b + c], p[c * b + r]);
+					}
+				}
+			}
+			permute(data, mb, nb, b * b);
+			for (size_t band = 0; band < nb; band++) {
+				permute(data + band * b * h, mb, b, b);
+			}
+			release();
+			m.swap_dimensions();
+		}
+
+		// Plain cycle following, one element at a time.
+		void transpose_cycles() {
+			extra_memory_ = 0;
+			permute(m.to_array(), m.height(), m.width(), 1);
+			release();
+			m.swap_dimensions();
+		}
+
+		// Return bytes of memory taken besides the matrix by the last transposition.
+		size_t extra_memory() const noexcept { return extra_memory_; }
+
+	private:
+		std::vector<bool> visited_;
+		std::vector<T> buffer_;
+		size_t extra_memory_;
+
+		// Largest common divisor of the dimensions up to 32.
+		static size_t block_size(const size_t h, const size_t w) {
+			for (size_t b = 32; b > 1; b--) {
+				if (h % b == 0 && w % b == 0) {
+					return b;
+				}
+			}
+			return 1;
+		}
+
+		// Transpose rows x cols matrix at data whose elements are pieces of
+		// piece consecutive elements. Each cycle is followed backwards: the
+		// piece belonging to the free position is moved there.
+		void permute(T* data, const size_t rows, const size_t cols, const size_t piece) {
+			const auto n = rows * cols;
+			if (rows == 1 || cols == 1) {
+				return;
+			}
+			visited_.assign(n, false);
+			buffer_.resize(piece);
+			extra_memory_ = std::max(extra_memory_, (n + 7) / 8 + piece * sizeof(T));
+			for (size_t start = 1; start + 1 < n; start++) {
+				if (visited_[start]) {
+					continue;
+				}
+				std::copy(data + start * piece, data + (start + 1) * piece, buffer_.begin());
+				auto free = start;
+				for (;;) {
+					visited_[free] = true;
+					// Position free of the result (cols x rows) holds element (free % rows, free / rows).
+					const auto from = (free % rows) * cols + free / rows;
+					if (from == start) {
+						break;
+					}
+					std::copy(data + from * piece, data + (from + 1) * piece, data + free * piece);
+					free = from;
+				}
+				std::copy(buffer_.begin(), buffer_.end(), data + free * piece);
+			}
+		}
+
+		void release() {
+			std::vector<bool>().swap(visited_);
+			std::vector<T>().swap(buffer_);
+		}
+	};
+
+	namespace detail {
+		// Copy the transposition of src to dst, by tiles of the tile kernel
+		// where they fit.
+		template<typename T>
+		void transpose_block_into(const matrix_view<const T>& src, const matrix_view<T>& dst) {
+			constexpr size_t tile = tile_kernel<T>::tile;
+			size_t h = 0;
+			for (; h + tile <= src.height(); h += tile) {
+				size_t w = 0;
+				for (; w + tile <= src.width(); w += tile) {
+					transpose_tile_into(&src.get(h, w), src.stride(), &dst.get(w, h), dst.stride());
+				}
+				for (; w < src.width(); w++) {
+					for (auto i = h; i < h + tile; i++) {
+						dst.get(w, i) = src.get(i, w);
+					}
+				}
+			}
+			for (; h < src.height(); h++) {
+				for (size_t w = 0; w < src.width(); w++) {
+					dst.get(w, h) = src.get(h, w);
+				}
+			}
+		}
+
+		// Halve the longer side until the block is at most 16x16 elements.
+		// Splits are rounded to whole tiles, so only the last block of a
+		// row or column has tiles that do not fit.
+		template<typename T>
+		void transpose_into(const matrix_view<const T>& src, const matrix_view<T>& dst) {
+			constexpr size_t tile = tile_kernel<T>::tile;
+			const auto r = src.height(), c = src.width();
+			if (r <= 16 && c <= 16) {
+				transpose_block_into(src, dst);
+			}
+			else if (r >= c) {
+				const auto half = (r / 2 + tile - 1) / tile * tile;
+				transpose_into(src.subview(0, 0, half, c), dst.subview(0, 0, c, half));
+				transpose_into(src.subview(half, 0, r - half, c), dst.subview(0, half, c, r - half));
+			}
+			else {
+				const auto half = (c / 2 + tile - 1) / tile * tile;
+				transpose_into(src.subview(0, 0, r, half), dst.subview(0, 0, half, r));
+				transpose_into(src.subview(0, half, r, c - half), dst.subview(half, 0, c - half, r));
+			}
+		}
+	}
+
+	// Store transposition of src of any dimensions to dst, which must be
+	// width x height of src and must not overlap it. Cache oblivious, with
+	// SIMD tiles at the bottom.
+	template<typename S, typename T>
+	void transpose_into(const matrix_view<S> src, const matrix_view<T> dst) {
+		static_assert(std::is_same<std::remove_const_t<S>, T>::value, "Views must have the same element type.");
+		CHECK_IF_TRANSPOSED(src, dst);
+		detail::transpose_into(matrix_view<const T>(src), dst);
+	}
+
+	template<typename T>
+	void transpose_into(const matrix<T>& src, matrix<T>& dst) {
+		transpose_into(src.view(), dst.view());
+	}
+
+	// Store transposition of src to dst by square blocks of a fixed side,
+	// the blocks go in row-major order.
+	template<typename S, typename T>
+	void transpose_into_tiled(const matrix_view<S> src, const matrix_view<T> dst, const size_t block = 64) {
+		static_assert(std::is_same<std::remove_const_t<S>, T>::value, "Views must have the same element type.");
+		CHECK_IF_TRANSPOSED(src, dst);
+		for (size_t h = 0; h < src.height(); h += block) {
+			for (size_t w = 0; w < src.width(); w += block) {
+				const auto bh = std::min(block, src.height() - h), bw = std::min(block, src.width() - w);
+				detail::transpose_block_into(matrix_view<const T>(src.subview(h, w, bh, bw)), dst.subview(w, h, bw, bh));
+			}
+		}
+	}
+
+	template<typename T>
+	void transpose_into_tiled(const matrix<T>& src, matrix<T>& dst, const size_t block = 64) {
+		transpose_into_tiled(src.view(), dst.view(), block);
+	}
 }
 
 #endif /* TRANSPOSITIONS_HPP */
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "../src/matrix.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+
+using namespace std;
+using namespace mt;
+
+TEST(MatrixTests, Stride) {
+	// Rows of 4-byte elements padded to an odd number of 64-byte lines.
+	EXPECT_EQ(storage::standard().stride(1024, 4), 1024u);
+	EXPECT_EQ(storage::cache_aligned().stride(1024, 4), 1040u);
+	EXPECT_EQ(storage::cache_aligned().stride(17, 4), 48u);
+	EXPECT_EQ(storage::cache_aligned().stride(16, 4), 16u);
+	EXPECT_EQ(storage::huge_page().stride(100, 8), 104u);
+	EXPECT_EQ(storage::huge_page(false).stride(100, 8), 100u);
+	// Elements not dividing a line are never padded.
+	EXPECT_EQ(storage::cache_aligned().stride(1024, 12), 1024u);
+
+	matrix<int32_t> padded(5, 1024, storage::huge_page());
+	EXPECT_EQ(padded.stride(), 1040u);
+	EXPECT_FALSE(padded.contiguous());
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(padded.to_array()) % storage::huge_page_size, 0u);
+	matrix<int32_t> plain(5, 1024);
+	EXPECT_EQ(plain.stride(), 1024u);
+	EXPECT_TRUE(plain.contiguous());
+}
+
+TEST(MatrixTests, Copy) {
+	matrix<int32_t> m(7, 33, storage::cache_aligned());
+	for (size_t h = 0; h < m.height(); h++) {
+		for (size_t w = 0; w < m.width(); w++) {
+			m.get(h, w) = int32_t(h * 100 + w);
+		}
+	}
+	const matrix<int32_t> copy(m);
+	EXPECT_EQ(copy.stride(), m.stride());
+	EXPECT_NE(copy.to_array(), m.to_array());
+	for (size_t h = 0; h < m.height(); h++) {
+		for (size_t w = 0; w < m.width(); w++) {
+			EXPECT_EQ(copy.get(h, w), int32_t(h * 100 + w));
+		}
+	}
+	matrix<int32_t> moved(std::move(m));
+	EXPECT_EQ(moved.get(6, 32), 632);
+	EXPECT_EQ(m.to_array(), nullptr);
+}
+
+TEST(MatrixTests, Submatrix) {
+	matrix<int32_t> m(10, 20, storage::cache_aligned());
+	for (size_t h = 0; h < m.height(); h++) {
+		for (size_t w = 0; w < m.width(); w++) {
+			m.get(h, w) = int32_t(h * 100 + w);
+		}
+	}
+	const auto v = m.submatrix(2, 3, 5, 6);
+	EXPECT_EQ(v.height(), 5u);
+	EXPECT_EQ(v.width(), 6u);
+	EXPECT_EQ(v.stride(), m.stride());
+	EXPECT_EQ(v.row(), 2u);
+	EXPECT_EQ(v.column(), 3u);
+	EXPECT_FALSE(v.contiguous());
+	EXPECT_EQ(v.get(0, 0), 203);
+	EXPECT_EQ(v.at(4, 5), 608);
+
+	// Nested views keep positions within the whole matrix.
+	const auto inner = v.submatrix(1, 2, 3, 4);
+	EXPECT_EQ(inner.row(), 3u);
+	EXPECT_EQ(inner.column(), 5u);
+	EXPECT_EQ(inner.get(2, 3), 508);
+	inner.get(0, 0) = -1;
+	EXPECT_EQ(m.get(3, 5), -1);
+
+	const matrix_view<const int32_t> c = inner;
+	EXPECT_EQ(c.get(0, 0), -1);
+	const matrix<int32_t>& cm = m;
+	EXPECT_EQ(cm.submatrix(9, 19, 1, 1).get(0, 0), 919);
+
+	EXPECT_THROW(m.submatrix(6, 0, 5, 1), std::out_of_range);
+	EXPECT_THROW(m.submatrix(0, 15, 1, 6), std::out_of_range);
+	EXPECT_THROW(v.submatrix(0, 0, 6, 1), std::out_of_range);
+	EXPECT_NO_THROW(v.submatrix(0, 0, 5, 6));
+	EXPECT_THROW(v.at(5, 0), std::out_of_range);
+	EXPECT_THROW(v.at(0, -1), std::out_of_range);
+}
+
+TEST(MatrixTests, Bounds) {
+	matrix<int32_t> m(3, 4);
+	EXPECT_NO_THROW(m.at(2, 3));
+	EXPECT_THROW(m.at(3, 0), std::out_of_range);
+	EXPECT_THROW(m.at(0, 4), std::out_of_range);
+	EXPECT_THROW(m.at(-1, 0), std::out_of_range);
+	EXPECT_THROW(matrix<int32_t>(0, 4), std::invalid_argument);
+	EXPECT_THROW(matrix<int32_t>(4, -1), std::invalid_argument);
+}
+
+int main(int argc, char *argv[]) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
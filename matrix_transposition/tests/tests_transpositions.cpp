@@ -0,0 +1,280 @@
+#include "../src/matrix.h"
+#include "../src/transpositions.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+using namespace mt;
+
+// Odd, tile-sized and padded dimensions, with and without remainder tiles.
+const vector<size_t> dimensions{ 1, 2, 3, 7, 8, 16, 17, 31, 33, 64, 100, 131 };
+
+const vector<storage> layouts{ storage::standard(), storage::cache_aligned(), storage::huge_page() };
+
+// Every element tells its position.
+template<typename T>
+void fill(const matrix_view<T>& v) {
+	for (size_t h = 0; h < v.height(); h++) {
+		for (size_t w = 0; w < v.width(); w++) {
+			v.get(h, w) = T(h * 1000 + w + 1);
+		}
+	}
+}
+
+// Reference for the engines, transposition of a square matrix by transposition_naive.
+template<typename T>
+matrix<T> naive_transposed(const matrix<T>& m) {
+	matrix<T> result(m);
+	transposition_naive<T> tn(result);
+	tn.transpose([&result](const size_t h, const size_t w) {
+		std::swap(result.get(h, w), result.get(w, h));
+	});
+	return result;
+}
+
+// Reference of any dimensions, element by element.
+template<typename T>
+matrix<T> naive_transposed(const matrix_view<const T>& v) {
+	matrix<T> result(v.width(), v.height());
+	for (size_t h = 0; h < v.height(); h++) {
+		for (size_t w = 0; w < v.width(); w++) {
+			result.get(w, h) = v.get(h, w);
+		}
+	}
+	return result;
+}
+
+template<typename T>
+void expect_equal(const matrix_view<const T>& actual, const matrix_view<const T>& expected) {
+	ASSERT_EQ(actual.height(), expected.height());
+	ASSERT_EQ(actual.width(), expected.width());
+	for (size_t h = 0; h < actual.height(); h++) {
+		for (size_t w = 0; w < actual.width(); w++) {
+			ASSERT_EQ(actual.get(h, w), expected.get(h, w)) << "at (" << h << ", " << w << ")";
+		}
+	}
+}
+
+template<typename T>
+void test_kernels() {
+	constexpr size_t tile = tile_kernel<T>::tile;
+	// A tile in the middle of a padded matrix, neighbours must stay as they are.
+	matrix<T> m(3 * tile, 3 * tile + 5, storage::cache_aligned());
+	fill(m.view());
+	const auto original = m.copy();
+	transpose_tile(&m.get(tile, tile), m.stride());
+	for (size_t h = 0; h < m.height(); h++) {
+		for (size_t w = 0; w < m.width(); w++) {
+			const bool inside = h >= tile && h < 2 * tile && w >= tile && w < 2 * tile;
+			EXPECT_EQ(m.get(h, w), (inside) ? original.get(w, h) : original.get(h, w));
+		}
+	}
+
+	m = original.copy();
+	swap_tiles(&m.get(2 * tile, 0), &m.get(0, 2 * tile), m.stride());
+	for (size_t h = 0; h < tile; h++) {
+		for (size_t w = 0; w < tile; w++) {
+			EXPECT_EQ(m.get(2 * tile + h, w), original.get(w, 2 * tile + h));
+			EXPECT_EQ(m.get(h, 2 * tile + w), original.get(2 * tile + w, h));
+		}
+	}
+
+	// Source and destination of different strides.
+	matrix<T> dst(tile + 3, tile + 1);
+	transpose_tile_into(&original.get(1, 2), original.stride(), &dst.get(2, 1), dst.stride());
+	for (size_t h = 0; h < tile; h++) {
+		for (size_t w = 0; w < tile; w++) {
+			EXPECT_EQ(dst.get(2 + w, 1 + h), original.get(1 + h, 2 + w));
+		}
+	}
+}
+
+// 2-byte elements take the generic kernel, the others SSE2 or AVX ones
+// depending on the target the test is compiled for.
+TEST(TranspositionsTests, Kernels) {
+	test_kernels<int16_t>();
+	test_kernels<int32_t>();
+	test_kernels<float>();
+	test_kernels<int64_t>();
+	test_kernels<double>();
+}
+
+TEST(TranspositionsTests, CacheOblivious) {
+	for (const auto& layout : layouts) {
+		for (const auto n : dimensions) {
+			matrix<int32_t> m(n, n, layout);
+			fill(m.view());
+			const auto expected = naive_transposed(m);
+			transposition_cache_oblivious<int32_t> to(m);
+			to.transpose([&m](const size_t h, const size_t w) {
+				std::swap(m.get(h, w), m.get(w, h));
+			});
+			expect_equal<int32_t>(m, expected);
+		}
+	}
+}
+
+template<typename T>
+void test_simd(work_stealing_pool* pool) {
+	for (const auto& layout : layouts) {
+		for (const auto n : dimensions) {
+			matrix<T> m(n, n, layout);
+			fill(m.view());
+			const auto expected = naive_transposed(m);
+			if (pool) {
+				transposition_simd<T> ts(m, *pool, 16);
+				ts.transpose();
+			}
+			else {
+				transposition_simd<T> ts(m);
+				ts.transpose();
+			}
+			expect_equal<T>(m, expected);
+		}
+	}
+}
+
+TEST(TranspositionsTests, Simd) {
+	test_simd<int16_t>(nullptr);
+	test_simd<int32_t>(nullptr);
+	test_simd<int64_t>(nullptr);
+	test_simd<double>(nullptr);
+}
+
+TEST(TranspositionsTests, SimdStrided) {
+	// A square block of a larger padded matrix is transposed in place of itself.
+	matrix<int32_t> m(150, 170, storage::huge_page());
+	fill(m.view());
+	const auto original = m.copy();
+	const auto block = m.submatrix(9, 21, 131, 131);
+	transposition_simd<int32_t> ts(block);
+	ts.transpose();
+	for (size_t h = 0; h < m.height(); h++) {
+		for (size_t w = 0; w < m.width(); w++) {
+			const bool inside = h >= 9 && h < 140 && w >= 21 && w < 152;
+			const auto expected = (inside) ? original.get(9 + w - 21, 21 + h - 9) : original.get(h, w);
+			ASSERT_EQ(m.get(h, w), expected) << "at (" << h << ", " << w << ")";
+		}
+	}
+	EXPECT_THROW(transposition_simd<int32_t>(m.submatrix(0, 0, 10, 11)), std::invalid_argument);
+}
+
+TEST(TranspositionsTests, WorkStealingPool) {
+	work_stealing_pool pool(4);
+	EXPECT_EQ(pool.thread_count(), 4u);
+	// Nested forks, waiting threads run tasks meanwhile.
+	std::atomic<size_t> leaves(0);
+	std::function<void(size_t)> split = [&](const size_t depth) {
+		if (depth == 0) {
+			++leaves;
+			return;
+		}
+		pool.invoke([&] { split(depth - 1); }, [&] { split(depth - 1); }, [&] { split(depth - 1); });
+	};
+	split(6);
+	EXPECT_EQ(leaves.load(), 729u);
+
+	test_simd<int32_t>(&pool);
+	test_simd<double>(&pool);
+	// Large enough for the tasks to be stolen by all threads.
+	matrix<int32_t> m(1031, 1031, storage::huge_page());
+	fill(m.view());
+	const auto expected = naive_transposed(m);
+	transposition_simd<int32_t> ts(m, pool, 64);
+	ts.transpose();
+	expect_equal<int32_t>(m, expected);
+}
+
+TEST(TranspositionsTests, InPlace) {
+	// Common divisors of 32, 8 and 4 take the blocked variant, the rest cycle following.
+	const vector<pair<size_t, size_t>> shapes{
+		{ 1, 1 }, { 1, 17 }, { 17, 1 }, { 2, 3 }, { 7, 13 }, { 12, 20 }, { 24, 40 }, { 64, 96 }, { 96, 32 },
+		{ 100, 36 }, { 33, 66 }, { 128, 128 } };
+	for (const auto& shape : shapes) {
+		for (const bool cycles : { false, true }) {
+			matrix<int32_t> m(shape.first, shape.second);
+			fill(m.view());
+			const auto expected = naive_transposed<int32_t>(m.view());
+			transposition_in_place<int32_t> tp(m);
+			if (cycles) {
+				tp.transpose_cycles();
+			}
+			else {
+				tp.transpose();
+			}
+			EXPECT_EQ(m.height(), shape.second);
+			EXPECT_EQ(m.width(), shape.first);
+			EXPECT_TRUE(m.contiguous());
+			expect_equal<int32_t>(m, expected);
+			EXPECT_LE(tp.extra_memory(), (shape.first * shape.second + 7) / 8 + 32 * 32 * sizeof(int32_t));
+		}
+	}
+	matrix<int32_t> padded(10, 20, storage::cache_aligned());
+	EXPECT_THROW(transposition_in_place<int32_t>{ padded }, std::invalid_argument);
+}
+
+template<typename T>
+void test_transpose_into(const size_t height, const size_t width) {
+	for (const auto& layout : layouts) {
+		matrix<T> src(height, width, layout);
+		fill(src.view());
+		const auto expected = naive_transposed<T>(src.view());
+		matrix<T> dst(width, height, layout);
+		transpose_into(src, dst);
+		expect_equal<T>(dst, expected);
+		for (const size_t block : { size_t(1), size_t(7), size_t(64) }) {
+			matrix<T> tiled = matrix<T>::zeros(width, height, layout);
+			transpose_into_tiled(src, tiled, block);
+			expect_equal<T>(tiled, expected);
+		}
+	}
+}
+
+TEST(TranspositionsTests, TransposeInto) {
+	const vector<pair<size_t, size_t>> shapes{
+		{ 1, 1 }, { 1, 100 }, { 100, 1 }, { 3, 5 }, { 17, 33 }, { 64, 8 }, { 131, 70 }, { 70, 131 }, { 256, 256 } };
+	for (const auto& shape : shapes) {
+		test_transpose_into<int16_t>(shape.first, shape.second);
+		test_transpose_into<int32_t>(shape.first, shape.second);
+		test_transpose_into<double>(shape.first, shape.second);
+	}
+}
+
+TEST(TranspositionsTests, TransposeIntoStrided) {
+	// Views into larger padded matrices on both sides.
+	matrix<int32_t> src(120, 90, storage::huge_page());
+	fill(src.view());
+	const matrix<int32_t>& source = src;
+	const auto from = source.submatrix(5, 3, 101, 77);
+	const auto expected = naive_transposed<int32_t>(from);
+	for (const bool tiled : { false, true }) {
+		auto dst = matrix<int32_t>::zeros(100, 130, storage::cache_aligned());
+		const auto to = dst.submatrix(11, 13, 77, 101);
+		if (tiled) {
+			transpose_into_tiled(from, to, 16);
+		}
+		else {
+			transpose_into(from, to);
+		}
+		expect_equal<int32_t>(to, expected);
+		// Nothing around the destination view is written.
+		for (size_t h = 0; h < dst.height(); h++) {
+			for (size_t w = 0; w < dst.width(); w++) {
+				if (h < 11 || h >= 88 || w < 13 || w >= 114) {
+					ASSERT_EQ(dst.get(h, w), 0);
+				}
+			}
+		}
+	}
+	matrix<int32_t> wrong(90, 121);
+	EXPECT_THROW(transpose_into(src, wrong), std::invalid_argument);
+	EXPECT_THROW(transpose_into_tiled(src, wrong), std::invalid_argument);
+}
+
+int main(int argc, char *argv[]) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
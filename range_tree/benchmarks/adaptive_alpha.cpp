@@ -0,0 +1,79 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+
+using namespace rt;
+using namespace std;
+
+/*
+ * Total work of 2D range trees with the fixed alphas of main.cpp and with
+ * the adaptive alpha within [0.52, 0.98] on a trace whose phases alternate
+ * between 90 % inserts and 90 % range counts. Output columns: tree, insert
+ * visits, range count visits, all visits and seconds.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [phase count] [phase length]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    const int phase_count = (argc > 2) ? stoi(argv[2]) : 10;
+    const int phase_length = (argc > 3) ? stoi(argv[3]) : 50000;
+
+    struct operation {
+        bool insert;
+        range_tree<2>::rect r;
+    };
+    vector<operation> trace;
+    mt19937 gen(2018);
+    uniform_int_distribution<int_least32_t> coord(0, 1 << 24);
+    uniform_int_distribution<int_least32_t> extent(0, 1 << 20);
+    uniform_int_distribution<int> percent(0, 99);
+    for (int phase = 0; phase < phase_count; ++phase) {
+        const int insert_percent = (phase % 2 == 0) ? 90 : 10;
+        for (int i = 0; i < phase_length; ++i) {
+            operation op;
+            op.insert = percent(gen) < insert_percent;
+            op.r.lo = {coord(gen), coord(gen)};
+            op.r.hi = {op.r.lo[0] + extent(gen), op.r.lo[1] + extent(gen)};
+            trace.push_back(op);
+        }
+    }
+
+    ofs << "#tree insert_visits range_count_visits visits seconds" << endl;
+    for (double alpha : {0.52, 0.7, 0.98, 0.0}) {
+        statistics_ s;
+        range_tree<2> tree((alpha > 0) ? alpha : 0.7, s);
+        if (alpha == 0)
+            tree.adapt_alpha(0.52, 0.98);
+        uint_least64_t insert_visits = 0;
+        uint_least64_t range_count_visits = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < trace.size(); ++i) {
+            if (trace[i].insert)
+                tree.insert(trace[i].r.lo);
+            else
+                tree.range_query(trace[i].r.lo, trace[i].r.hi);
+            // Keep the 32-bit counters far from overflow.
+            if (i % size_t(phase_length) == size_t(phase_length) - 1) {
+                insert_visits += s.insert_visits;
+                range_count_visits += s.range_count_visits;
+                s.reset();
+                if (alpha == 0)
+                    tree.adapt_alpha(0.52, 0.98);
+            }
+        }
+        auto end = chrono::steady_clock::now();
+        insert_visits += s.insert_visits;
+        range_count_visits += s.range_count_visits;
+        ofs << ((alpha > 0) ? to_string(alpha) : string("adaptive")) << " " << insert_visits << " "
+            << range_count_visits << " " << insert_visits + range_count_visits << " "
+            << chrono::duration<double>(end - start).count() << endl;
+        cout << "TREE " << ((alpha > 0) ? to_string(alpha) : string("adaptive")) << " FINISHED!" << endl;
+    }
+}
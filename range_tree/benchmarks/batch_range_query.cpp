@@ -0,0 +1,56 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+
+using namespace rt;
+using namespace std;
+
+/*
+ * Scaling of range_query_batch on a frozen 2D range tree with 1 to 64
+ * threads. Output columns: thread count, batch time in seconds and speedup
+ * against one thread.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [point count] [query count]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    const size_t point_count = (argc > 2) ? size_t(stoul(argv[2])) : 1000000;
+    const size_t query_count = (argc > 3) ? size_t(stoul(argv[3])) : 100000;
+
+    statistics_ s;
+    range_tree<2> tree(0.7, s);
+    mt19937 gen(2018);
+    uniform_int_distribution<int_least32_t> coord(0, 1 << 24);
+    vector<range_tree<2>::point_type> points(point_count);
+    for (auto &p : points)
+        p = {coord(gen), coord(gen)};
+    tree.assign(points);
+
+    vector<range_tree<2>::rect> queries(query_count);
+    uniform_int_distribution<int_least32_t> extent(0, 1 << 20);
+    for (auto &q : queries) {
+        q.lo = {coord(gen), coord(gen)};
+        q.hi = {q.lo[0] + extent(gen), q.lo[1] + extent(gen)};
+    }
+
+    ofs << "#threads seconds speedup" << endl;
+    vector<int_least32_t> counts;
+    double single = 0;
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        auto start = chrono::steady_clock::now();
+        tree.range_query_batch(queries, counts, threads);
+        auto end = chrono::steady_clock::now();
+        double seconds = chrono::duration<double>(end - start).count();
+        if (threads == 1)
+            single = seconds;
+        ofs << threads << " " << seconds << " " << single / seconds << endl;
+        cout << "THREADS " << threads << " FINISHED!" << endl;
+    }
+}
@@ -0,0 +1,70 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include "../src/bbalpha_tree.h"
+
+using namespace rt;
+using namespace std;
+
+// Exposes rebuild of the whole tree.
+class rebuildable : public bbalpha<int_least32_t> {
+public:
+    using bbalpha<int_least32_t>::bbalpha;
+    using bbalpha<int_least32_t>::rebuild;
+};
+
+/*
+ * Throughput of the search paths and of rebuilds of one BB[alpha] tree
+ * grown by random inserts, so its nodes are scattered over the heap like
+ * in a long running tree. Output columns: element count, inserts, range
+ * counts and rebuilt nodes per second.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [element count] [query count]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    const size_t element_count = (argc > 2) ? size_t(stoul(argv[2])) : 1000000;
+    const size_t query_count = (argc > 3) ? size_t(stoul(argv[3])) : 1000000;
+
+    mt19937 gen(2018);
+    uniform_int_distribution<int_least32_t> value(0, 1 << 30);
+    vector<int_least32_t> values(element_count);
+    for (auto &v : values)
+        v = value(gen);
+    vector<int_least32_t> queries(query_count);
+    for (auto &q : queries)
+        q = value(gen);
+
+    ofs << "#N inserts_per_second range_counts_per_second rebuilt_nodes_per_second" << endl;
+    statistics_ s;
+    rebuildable tree(0.7, s);
+    auto start = chrono::steady_clock::now();
+    for (auto v : values) {
+        tree.insert(v);
+        tree.statistics(true, true);
+    }
+    auto end = chrono::steady_clock::now();
+    double insert_rate = double(element_count) / chrono::duration<double>(end - start).count();
+
+    int_least64_t total = 0;
+    start = chrono::steady_clock::now();
+    for (auto q : queries)
+        total += tree.range_count(q, q + (1 << 20));
+    end = chrono::steady_clock::now();
+    double count_rate = double(query_count) / chrono::duration<double>(end - start).count();
+
+    const int rebuilds = 5;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < rebuilds; ++i)
+        tree.rebuild(tree.tree);
+    end = chrono::steady_clock::now();
+    double rebuild_rate = double(rebuilds) * double(element_count) / chrono::duration<double>(end - start).count();
+
+    ofs << element_count << " " << insert_rate << " " << count_rate << " " << rebuild_rate << endl;
+    cout << "TREE FINISHED! (" << total << ")" << endl;
+}
@@ -0,0 +1,76 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/bbalpha_tree.h"
+#include "../src/concurrent_bbalpha.h"
+
+using namespace rt;
+using namespace std;
+
+/*
+ * One writer inserting into concurrent_bbalpha while 0 to 16 readers run
+ * range counts. Output columns: reader count, writer inserts per second and
+ * range counts per second summed over all readers. The first line is plain
+ * bbalpha insert throughput for comparison.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [insert count]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    const int insert_count = (argc > 2) ? stoi(argv[2]) : 1000000;
+
+    mt19937 gen(2018);
+    uniform_int_distribution<int_least32_t> value(0, 1 << 30);
+    vector<int_least32_t> values(static_cast<size_t>(insert_count));
+    for (auto &v : values)
+        v = value(gen);
+
+    ofs << "#readers inserts_per_s queries_per_s" << endl;
+    {
+        statistics_ s;
+        bbalpha<int_least32_t> tree(0.7, s);
+        auto start = chrono::steady_clock::now();
+        for (auto v : values)
+            tree.insert(v);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        ofs << "# bbalpha " << insert_count / seconds << endl;
+    }
+
+    for (unsigned reader_count = 0; reader_count <= 16; reader_count = reader_count ? reader_count * 2 : 1) {
+        statistics_ s;
+        concurrent_bbalpha<int_least32_t> tree(0.7, s);
+        atomic<bool> done{false};
+        atomic<uint_least64_t> queries{0};
+        vector<thread> readers;
+        for (unsigned r = 0; r < reader_count; ++r) {
+            readers.emplace_back([&tree, &done, &queries, r]() {
+                concurrent_bbalpha<int_least32_t>::reader reader(tree);
+                mt19937 reader_gen(r);
+                uniform_int_distribution<int_least32_t> bound(0, 1 << 30);
+                uint_least64_t local = 0;
+                while (!done.load(memory_order_relaxed)) {
+                    auto lo = bound(reader_gen);
+                    reader.range_count(lo, lo + (1 << 24));
+                    ++local;
+                }
+                queries += local;
+            });
+        }
+        auto start = chrono::steady_clock::now();
+        for (auto v : values)
+            tree.insert(v);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        done.store(true);
+        for (auto &t : readers)
+            t.join();
+        ofs << reader_count << " " << insert_count / seconds << " " << queries.load() / seconds << endl;
+        cout << "READERS " << reader_count << " FINISHED!" << endl;
+    }
+}
@@ -0,0 +1,110 @@
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "../src/logarithmic_range_tree.h"
+
+using namespace rt;
+using namespace std;
+
+struct operation {
+    bool insert;
+    array<int_least32_t, 4> args;
+};
+
+/*
+ * Replay the trace and write one output line.
+ */
+template<typename Tree>
+void replay(ofstream &ofs, const string &name, Tree &tree, statistics_ &s, const vector<operation> &trace) {
+    double max_insert = 0;
+    int_least64_t total = 0;
+    auto start = chrono::steady_clock::now();
+    for (const auto &op : trace) {
+        if (op.insert) {
+            auto before = chrono::steady_clock::now();
+            tree.insert(op.args[0], op.args[1]);
+            max_insert = max(max_insert, chrono::duration<double>(chrono::steady_clock::now() - before).count());
+        }
+        else {
+            total += tree.range_query(op.args[0], op.args[1], op.args[2], op.args[3]);
+        }
+    }
+    auto end = chrono::steady_clock::now();
+    ofs << name << " " << chrono::duration<double>(end - start).count() << " " << max_insert << " "
+        << s.insert_visits << " " << s.max_insert_visits << " " << s.range_count_visits << " " << total << endl;
+    cout << name << " FINISHED!" << endl;
+}
+
+/*
+ * Range tree with bbalpha partial rebuilds against the logarithmic method,
+ * amortized and deamortized, on one trace. The trace is read from the
+ * standard input in the format of main.cpp when the second argument is
+ * "-", otherwise it is random with the given number of operations, one in
+ * ten of them a query. Output columns: tree, seconds, largest insert
+ * seconds, insert visits, largest insert visits, query visits and the sum
+ * of counts.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [operation count | -]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    vector<operation> trace;
+    if (argc > 2 && string(argv[2]) == "-") {
+        string line;
+        while (getline(cin, line)) {
+            stringstream ss(line);
+            string kind;
+            ss >> kind;
+            if (kind == "I") {
+                operation op{true, {0, 0, 0, 0}};
+                ss >> op.args[0] >> op.args[1];
+                trace.push_back(op);
+            }
+            else if (kind == "C") {
+                operation op{false, {0, 0, 0, 0}};
+                ss >> op.args[0] >> op.args[1] >> op.args[2] >> op.args[3];
+                trace.push_back(op);
+            }
+        }
+    }
+    else {
+        const size_t count = (argc > 2) ? size_t(stoul(argv[2])) : 1000000;
+        mt19937 gen(2018);
+        uniform_int_distribution<int_least32_t> coord(0, 1 << 24);
+        uniform_int_distribution<int_least32_t> extent(0, 1 << 20);
+        for (size_t i = 0; i < count; ++i) {
+            int_least32_t x = coord(gen), y = coord(gen);
+            if (i % 10 == 9)
+                trace.push_back({false, {x, y, x + extent(gen), y + extent(gen)}});
+            else
+                trace.push_back({true, {x, y, 0, 0}});
+        }
+    }
+
+    ofs << "#tree seconds max_insert_seconds insert_visits max_insert_visits query_visits count_sum" << endl;
+    {
+        statistics_ s;
+        logarithmic_range_tree<> tree(s);
+        replay(ofs, "logarithmic", tree, s, trace);
+    }
+    {
+        statistics_ s;
+        logarithmic_range_tree<> tree(s, true);
+        replay(ofs, "deamortized", tree, s, trace);
+    }
+    // The last one, freeing its nodes would slow down the others.
+    {
+        statistics_ s;
+        range_tree<2> tree(0.7, s);
+        replay(ofs, "bbalpha", tree, s, trace);
+    }
+}
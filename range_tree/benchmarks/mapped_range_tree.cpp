@@ -0,0 +1,74 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "../src/mapped_range_tree.h"
+
+using namespace rt;
+using namespace std;
+
+/*
+ * Startup and query time of the file-backed range tree compared to
+ * building the in-memory one from raw points. The tree file is written
+ * next to the output file. Output columns: tree, startup seconds, seconds
+ * per query and the sum of counts.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [point count] [query count]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    const string tree_path = string(argv[1]) + ".tree";
+    const size_t point_count = (argc > 2) ? size_t(stoul(argv[2])) : 1000000;
+    const size_t query_count = (argc > 3) ? size_t(stoul(argv[3])) : 100000;
+
+    mt19937 gen(2018);
+    uniform_int_distribution<int_least32_t> coord(0, 1 << 24);
+    vector<range_tree<2>::point_type> points(point_count);
+    for (auto &p : points)
+        p = {coord(gen), coord(gen)};
+    vector<range_tree<2>::rect> queries(query_count);
+    uniform_int_distribution<int_least32_t> extent(0, 1 << 20);
+    for (auto &q : queries) {
+        q.lo = {coord(gen), coord(gen)};
+        q.hi = {q.lo[0] + extent(gen), q.lo[1] + extent(gen)};
+    }
+    ofs << "#tree startup_seconds query_seconds count_sum" << endl;
+
+    {
+        statistics_ s;
+        range_tree<2> tree(0.7, s);
+        auto start = chrono::steady_clock::now();
+        tree.build(points);
+        auto end = chrono::steady_clock::now();
+        double startup_seconds = chrono::duration<double>(end - start).count();
+        int_least64_t total = 0;
+        start = chrono::steady_clock::now();
+        for (const auto &q : queries)
+            total += tree.range_query(q.lo, q.hi);
+        end = chrono::steady_clock::now();
+        ofs << "memory " << startup_seconds << " "
+            << chrono::duration<double>(end - start).count() / double(query_count) << " " << total << endl;
+        cout << "MEMORY FINISHED!" << endl;
+    }
+
+    mapped_range_tree<>::write(tree_path, points);
+    points = vector<range_tree<2>::point_type>();
+    auto start = chrono::steady_clock::now();
+    mapped_range_tree<> tree(tree_path);
+    auto end = chrono::steady_clock::now();
+    double startup_seconds = chrono::duration<double>(end - start).count();
+    int_least64_t total = 0;
+    start = chrono::steady_clock::now();
+    for (const auto &q : queries)
+        total += tree.range_query(q.lo[0], q.lo[1], q.hi[0], q.hi[1]);
+    end = chrono::steady_clock::now();
+    ofs << "mapped " << startup_seconds << " "
+        << chrono::duration<double>(end - start).count() / double(query_count) << " " << total << endl;
+    cout << "MAPPED FINISHED!" << endl;
+}
@@ -0,0 +1,61 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+
+using namespace rt;
+using namespace std;
+
+/*
+ * Memory footprint and query time of a 2D range tree with pointer-based
+ * last level (block 0) and compact last levels of several block sizes.
+ * Output columns: block size, bytes, bytes per point, build seconds and
+ * seconds per query.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [point count] [query count]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    const size_t point_count = (argc > 2) ? size_t(stoul(argv[2])) : 1000000;
+    const size_t query_count = (argc > 3) ? size_t(stoul(argv[3])) : 100000;
+
+    mt19937 gen(2018);
+    uniform_int_distribution<int_least32_t> coord(0, 1 << 24);
+    vector<range_tree<2>::point_type> points(point_count);
+    for (auto &p : points)
+        p = {coord(gen), coord(gen)};
+    vector<range_tree<2>::rect> queries(query_count);
+    uniform_int_distribution<int_least32_t> extent(0, 1 << 20);
+    for (auto &q : queries) {
+        q.lo = {coord(gen), coord(gen)};
+        q.hi = {q.lo[0] + extent(gen), q.lo[1] + extent(gen)};
+    }
+
+    ofs << "#block bytes bytes_per_point build_seconds query_seconds" << endl;
+    for (int_least32_t block : {0, 16, 64, 256, 1024}) {
+        statistics_ s;
+        range_tree<2> tree(0.7, s, block);
+        auto start = chrono::steady_clock::now();
+        tree.build(points);
+        auto end = chrono::steady_clock::now();
+        double build_seconds = chrono::duration<double>(end - start).count();
+
+        int_least64_t total = 0;
+        start = chrono::steady_clock::now();
+        for (const auto &q : queries)
+            total += tree.range_query(q.lo, q.hi);
+        end = chrono::steady_clock::now();
+        double query_seconds = chrono::duration<double>(end - start).count() / double(query_count);
+
+        size_t bytes = tree.memory_footprint();
+        ofs << block << " " << bytes << " " << double(bytes) / double(point_count) << " " << build_seconds << " "
+            << query_seconds << endl;
+        cout << "BLOCK " << block << " FINISHED! (" << total << ")" << endl;
+    }
+}
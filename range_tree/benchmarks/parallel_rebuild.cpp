@@ -0,0 +1,75 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+
+using namespace rt;
+using namespace std;
+
+// Exposes rebuild of the whole tree.
+class rebuildable : public bbalpha<int_least32_t> {
+public:
+    using bbalpha<int_least32_t>::bbalpha;
+    using bbalpha<int_least32_t>::rebuild;
+};
+
+/*
+ * Speedup of rebuilding large subtrees with 1 to 64 threads. Rebuilds
+ * the whole BB[alpha] tree and assigns the whole 2D range tree (which
+ * builds the lower trees as a rebuild of the root does). Output columns:
+ * thread count, bbalpha rebuild seconds and speedup, range tree seconds
+ * and speedup, all against one thread.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [element count]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    const size_t element_count = (argc > 2) ? size_t(stoul(argv[2])) : 1000000;
+
+    mt19937 gen(2018);
+    uniform_int_distribution<int_least32_t> coord(0, 1 << 24);
+    vector<int_least32_t> values(element_count);
+    for (auto &v : values)
+        v = coord(gen);
+    sort(values.begin(), values.end());
+    vector<range_tree<2>::point_type> points(element_count);
+    for (auto &p : points)
+        p = {coord(gen), coord(gen)};
+
+    statistics_ s;
+    rebuildable tree(0.7, s);
+    tree.tree = tree.build(values.data(), int_least32_t(element_count));
+
+    ofs << "#threads bbalpha_seconds bbalpha_speedup range_tree_seconds range_tree_speedup" << endl;
+    double single_bbalpha = 0;
+    double single_range_tree = 0;
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        tree.rebuild_threads = threads;
+        auto start = chrono::steady_clock::now();
+        tree.rebuild(tree.tree);
+        auto end = chrono::steady_clock::now();
+        double bbalpha_seconds = chrono::duration<double>(end - start).count();
+
+        range_tree<2> range(0.7, s);
+        range.rebuild_threads = threads;
+        start = chrono::steady_clock::now();
+        range.assign(points);
+        end = chrono::steady_clock::now();
+        double range_tree_seconds = chrono::duration<double>(end - start).count();
+
+        if (threads == 1) {
+            single_bbalpha = bbalpha_seconds;
+            single_range_tree = range_tree_seconds;
+        }
+        ofs << threads << " " << bbalpha_seconds << " " << single_bbalpha / bbalpha_seconds << " "
+            << range_tree_seconds << " " << single_range_tree / range_tree_seconds << endl;
+        cout << "THREADS " << threads << " FINISHED!" << endl;
+    }
+}
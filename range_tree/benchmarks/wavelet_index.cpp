@@ -0,0 +1,71 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "../src/wavelet_index.h"
+
+using namespace rt;
+using namespace std;
+
+/*
+ * Memory footprint and query throughput of the static wavelet index
+ * against the 2D range tree with pointer-based and compact last level, for
+ * growing point counts. Output columns: point count, then bytes per point
+ * and queries per second of each structure.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [max point count] [query count]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    const size_t max_point_count = (argc > 2) ? size_t(stoul(argv[2])) : 4000000;
+    const size_t query_count = (argc > 3) ? size_t(stoul(argv[3])) : 100000;
+
+    mt19937 gen(2018);
+    uniform_int_distribution<int_least32_t> coord(0, 1 << 24);
+    vector<range_tree<2>::rect> queries(query_count);
+    uniform_int_distribution<int_least32_t> extent(0, 1 << 20);
+    for (auto &q : queries) {
+        q.lo = {coord(gen), coord(gen)};
+        q.hi = {q.lo[0] + extent(gen), q.lo[1] + extent(gen)};
+    }
+
+    ofs << "#N wavelet_bytes wavelet_qps tree_bytes tree_qps compact_bytes compact_qps" << endl;
+    for (size_t point_count = 1000; point_count <= max_point_count; point_count *= 4) {
+        vector<range_tree<2>::point_type> points(point_count);
+        for (auto &p : points)
+            p = {coord(gen), coord(gen)};
+
+        int_least64_t wavelet_total = 0;
+        wavelet_index<> index(points);
+        auto start = chrono::steady_clock::now();
+        for (const auto &q : queries)
+            wavelet_total += index.range_query(q.lo[0], q.lo[1], q.hi[0], q.hi[1]);
+        auto end = chrono::steady_clock::now();
+        double wavelet_seconds = chrono::duration<double>(end - start).count();
+        ofs << point_count << " " << double(index.memory_footprint()) / double(point_count) << " "
+            << double(query_count) / wavelet_seconds;
+
+        for (int_least32_t block : {0, 64}) {
+            statistics_ s;
+            range_tree<2> tree(0.7, s, block);
+            tree.build(points);
+            int_least64_t total = 0;
+            start = chrono::steady_clock::now();
+            for (const auto &q : queries)
+                total += tree.range_query(q.lo[0], q.lo[1], q.hi[0], q.hi[1]);
+            end = chrono::steady_clock::now();
+            double seconds = chrono::duration<double>(end - start).count();
+            if (total != wavelet_total)
+                cout << "COUNTS DIFFER!" << endl;
+            ofs << " " << double(tree.memory_footprint()) / double(point_count) << " " << double(query_count) / seconds;
+        }
+        ofs << endl;
+        cout << "N " << point_count << " FINISHED!" << endl;
+    }
+}
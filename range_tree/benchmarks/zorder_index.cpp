@@ -0,0 +1,103 @@
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "../src/zorder_index.h"
+
+using namespace rt;
+using namespace std;
+
+struct operation {
+    bool insert;
+    array<int_least32_t, 4> args;
+};
+
+template<typename Tree>
+void replay(ofstream &ofs, const string &name, Tree &tree, statistics_ &s, const vector<operation> &trace) {
+    double insert_seconds = 0, query_seconds = 0;
+    size_t queries = 0;
+    int_least64_t total = 0;
+    for (const auto &op : trace) {
+        auto start = chrono::steady_clock::now();
+        if (op.insert) {
+            tree.insert(op.args[0], op.args[1]);
+            insert_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        else {
+            total += tree.range_query(op.args[0], op.args[1], op.args[2], op.args[3]);
+            query_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            ++queries;
+        }
+    }
+    ofs << name << " " << insert_seconds << " " << ((queries) ? double(queries) / query_seconds : 0) << " "
+        << tree.memory_footprint() << " " << s.range_count_visits << " " << total << endl;
+    cout << name << " FINISHED!" << endl;
+}
+
+/*
+ * Z-order index against the range tree on one trace, read from the
+ * standard input in the format of main.cpp when the second argument is
+ * "-". Otherwise points are drawn around a few cluster centers, like
+ * geographic data, and one in ten operations is a query of a rectangle
+ * near one of the centers. Output columns: index, insert seconds, queries
+ * per second, bytes, query visits and the sum of counts.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "Arguments -- output file name [operation count | -]." << endl;
+        throw 1;
+    }
+    ofstream ofs{ argv[1] };
+    vector<operation> trace;
+    if (argc > 2 && string(argv[2]) == "-") {
+        string line;
+        while (getline(cin, line)) {
+            stringstream ss(line);
+            string kind;
+            ss >> kind;
+            operation op{kind == "I", {0, 0, 0, 0}};
+            if (kind == "I")
+                ss >> op.args[0] >> op.args[1];
+            else if (kind == "C")
+                ss >> op.args[0] >> op.args[1] >> op.args[2] >> op.args[3];
+            else
+                continue;
+            trace.push_back(op);
+        }
+    }
+    else {
+        const size_t count = (argc > 2) ? size_t(stoul(argv[2])) : 1000000;
+        mt19937 gen(2018);
+        uniform_int_distribution<int_least32_t> center(0, 1 << 24);
+        vector<array<int_least32_t, 2>> centers(64);
+        for (auto &c : centers)
+            c = {center(gen), center(gen)};
+        uniform_int_distribution<size_t> pick(0, centers.size() - 1);
+        normal_distribution<double> offset(0, 1 << 14);
+        for (size_t i = 0; i < count; ++i) {
+            const auto &c = centers[pick(gen)];
+            int_least32_t x = c[0] + int_least32_t(offset(gen)), y = c[1] + int_least32_t(offset(gen));
+            if (i % 10 == 9)
+                trace.push_back({false, {x, y, x + int_least32_t(abs(offset(gen))), y + int_least32_t(abs(offset(gen)))}});
+            else
+                trace.push_back({true, {x, y, 0, 0}});
+        }
+    }
+
+    ofs << "#index insert_seconds queries_per_second bytes query_visits count_sum" << endl;
+    {
+        statistics_ s;
+        zorder_index<> index(s);
+        replay(ofs, "zorder", index, s, trace);
+    }
+    {
+        statistics_ s;
+        range_tree<2> tree(0.7, s);
+        replay(ofs, "range_tree", tree, s, trace);
+    }
+}
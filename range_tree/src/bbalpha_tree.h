@@ -7,6 +7,16 @@
 #include <cassert>
 #include <tuple>  // Usage of tuple and tie can be easily avoided. Used for cleaner & readable code.
 #include <algorithm>  // For sorting within debugging parts of code.
+#include <vector>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <thread>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+#include <cmath>
+#include <memory>
 
 #define NDEBUG
 
@@ -21,6 +31,8 @@ namespace rt {
         uint_least32_t last_insert_visits = 0;
         uint_least32_t insert_visits = 0;
         uint_least32_t insert_calls = 0;
+        // Part of insert_visits spent by rebuilds.
+        uint_least32_t rebuild_visits = 0;
 
         void reset() {
             max_range_count_visits = 0;
@@ -31,31 +43,206 @@ namespace rt {
             last_insert_visits = 0;
             insert_visits = 0;
             insert_calls = 0;
+            rebuild_visits = 0;
         }
+
+        /*
+         * Count visited nodes of an insert (or range count) operation, or
+         * finish the operation when operation_end is set.
+         */
+        void record(const bool insert, const bool operation_end, const uint_least32_t visits = 1) noexcept {
+            if (insert) {
+                if (operation_end) {
+                    if (last_insert_visits > max_insert_visits)
+                        max_insert_visits = last_insert_visits;
+                    last_insert_visits = 0;
+                    ++insert_calls;
+                }
+                else {
+                    last_insert_visits += visits;
+                    insert_visits += visits;
+                }
+            }
+            else {
+                if (operation_end) {
+                    if (last_range_count_visits > max_range_count_visits)
+                        max_range_count_visits = last_range_count_visits;
+                    last_range_count_visits = 0;
+                    ++range_count_calls;
+                }
+                else {
+                    last_range_count_visits += visits;
+                    range_count_visits += visits;
+                }
+            }
+        }
+    };
+
+    /*
+     * Aggregates kept in bbalpha nodes over their subtrees. An aggregate
+     * policy is a monoid -- it provides type, identity(), of(value) and an
+     * associative combine(a, b) -- and weight_type its of() accepts when
+     * used in range_tree. The default one keeps nothing.
+     */
+    struct no_aggregate {
+        struct type {};
+        using weight_type = type;
+        static type identity() noexcept { return {}; }
+        template<typename V>
+        static type of(const V &) noexcept { return {}; }
+        static type combine(const type &, const type &) noexcept { return {}; }
+    };
+
+    template<typename W>
+    struct sum_aggregate {
+        using type = W;
+        using weight_type = W;
+        static type identity() noexcept { return W(); }
+        static type of(const W &w) noexcept { return w; }
+        static type combine(const type &a, const type &b) noexcept { return a + b; }
+    };
+
+    template<typename W>
+    struct min_aggregate {
+        using type = W;
+        using weight_type = W;
+        static type identity() noexcept { return std::numeric_limits<W>::max(); }
+        static type of(const W &w) noexcept { return w; }
+        static type combine(const type &a, const type &b) noexcept { return (b < a) ? b : a; }
+    };
+
+    template<typename W>
+    struct max_aggregate {
+        using type = W;
+        using weight_type = W;
+        static type identity() noexcept { return std::numeric_limits<W>::lowest(); }
+        static type of(const W &w) noexcept { return w; }
+        static type combine(const type &a, const type &b) noexcept { return (a < b) ? b : a; }
+    };
+
+    /*
+     * Holder of a value which takes no space (as a base class) when the type
+     * of the value is empty, so that nodes without aggregates do not grow.
+     */
+    template<typename V, bool = std::is_empty<V>::value>
+    class compressed_value {
+        V value_ = V();
+    public:
+        compressed_value() = default;
+        explicit compressed_value(const V &v) : value_(v) {}
+        const V &get() const noexcept { return value_; }
+        void set(const V &v) noexcept { value_ = v; }
+    };
+
+    template<typename V>
+    class compressed_value<V, true> {
+    public:
+        compressed_value() = default;
+        explicit compressed_value(const V &) {}
+        V get() const noexcept { return V(); }
+        void set(const V &) noexcept {}
+    };
+
+    /*
+     * Default key extraction, the whole value is the key.
+     */
+    struct identity_key {
+        template<typename V>
+        const V &operator()(const V &v) const noexcept { return v; }
+    };
+
+    /*
+     * Links of a tree node, kept in front of its key and value.
+     */
+    template<typename Node>
+    struct node_links {
+        Node *right = nullptr;
+        Node *left = nullptr;
+        Node *parent = nullptr;
+        int_least32_t subtree_size = 1;
+    };
+
+    /*
+     * Value of a node with its key extracted by KeyOf when constructed, so
+     * that searches read the small key right behind the links instead of
+     * the whole value. The key of a value must not change afterwards.
+     */
+    template<typename T, typename KeyOf>
+    class keyed_value {
+    public:
+        using key_type = std::decay_t<decltype(KeyOf()(std::declval<const T &>()))>;
+
+    private:
+        key_type key_;
+
+    public:
+        T value;
+
+        keyed_value() : key_(), value() {}
+        explicit keyed_value(const T &v) : key_(KeyOf()(v)), value(v) {}
+        explicit keyed_value(T &&v) : key_(KeyOf()(v)), value(std::move(v)) {}
+        const key_type &key() const noexcept { return key_; }
     };
 
+    // The value is its own key, nothing is stored twice.
     template<typename T>
+    class keyed_value<T, identity_key> {
+    public:
+        using key_type = T;
+
+        T value = T();
+
+        keyed_value() = default;
+        explicit keyed_value(const T &v) : value(v) {}
+        explicit keyed_value(T &&v) : value(std::move(v)) {}
+        const key_type &key() const noexcept { return value; }
+    };
+
+    /*
+     * Sorted sequence of the values of a subtree, as in a merge sort tree --
+     * the sorted sequences of its right and left subtrees merged, and the
+     * value of the node itself inserted after the equal ones. Before orders
+     * the sequences (descending, for trees built by build_t).
+     */
+    template<typename V, typename Before>
+    std::vector<V> merge_subtree(const std::vector<V> &right, const std::vector<V> &left, V own, Before &&before) {
+        std::vector<V> merged;
+        merged.reserve(right.size() + left.size() + 1);
+        std::merge(right.begin(), right.end(), left.begin(), left.end(), std::back_inserter(merged), before);
+        merged.insert(std::upper_bound(merged.begin(), merged.end(), own, before), std::move(own));
+        return merged;
+    }
+
+    /*
+     * Nodes are ordered by keys KeyOf extracts from values, compared by
+     * (stateless) Compare, larger keys go to the right subtree.
+     */
+    template<typename T, typename Aggregate = no_aggregate, typename Compare = std::less<>, typename KeyOf = identity_key>
     class bbalpha {
     public:
-        class node {
-        public:
-            node *right = nullptr;
-            node *left = nullptr;
-            node *parent = nullptr;
-            int_least32_t subtree_size = 1;
-            T value = T();
+        using aggregate_type = typename Aggregate::type;
+        using key_type = typename keyed_value<T, KeyOf>::key_type;
 
+        class node : private compressed_value<aggregate_type>, public node_links<node>, public keyed_value<T, KeyOf> {
+        public:
             node() = default;
-            explicit node(const T &v) : value(v) {}
-            explicit node(T &&v) : value(std::move(v)) {}
+            explicit node(const T &v) : keyed_value<T, KeyOf>(v) {}
+            explicit node(T &&v) : keyed_value<T, KeyOf>(std::move(v)) {}
             node(const node &other) = delete;
             node(node &&other) = delete;
             node &operator=(const node &other) = delete;
             node &operator=(node &&other) = delete;
+            // Aggregate over values of the whole subtree.
+            decltype(auto) aggregate() const noexcept {
+                return compressed_value<aggregate_type>::get();
+            }
+            void set_aggregate(const aggregate_type &a) noexcept {
+                compressed_value<aggregate_type>::set(a);
+            }
             node **parent_ptr_address() const noexcept {
                 node **address = nullptr;
-                if (parent)
-                    address = (parent->right == this) ? &(parent->right) : &(parent->left);
+                if (this->parent)
+                    address = (this->parent->right == this) ? &(this->parent->right) : &(this->parent->left);
                 return address;
             }
 
@@ -63,22 +250,111 @@ namespace rt {
              * Simple recursive destructor.
              */
             ~node() {
-                delete right;
-                delete left;
+                delete this->right;
+                delete this->left;
+            }
+        };
+
+        /*
+         * Lazy in-order enumeration of nodes with lo <= value <= hi from the
+         * smallest to the largest value. Only the path to lo and the reported
+         * nodes are visited, so taking k nodes costs O(log n + k). The tree
+         * must not be modified while the iterator is in use.
+         */
+        class range_iterator {
+        public:
+            range_iterator(bbalpha &t, const key_type &lo, const key_type &hi) : tree_(t), lo_(lo), hi_(hi) {
+                descend(t.tree);
+            }
+
+            /*
+             * Return next node within the range or nullptr when the range is exhausted.
+             */
+            node *next() {
+                if (stack_.empty())
+                    return nullptr;
+                node *n = stack_.back();
+                stack_.pop_back();
+                if (less(hi_, n->key())) {
+                    stack_.clear();
+                    return nullptr;
+                }
+                descend(n->right);
+                return n;
+            }
+
+        private:
+            bbalpha &tree_;
+            const key_type lo_;
+            const key_type hi_;
+            std::vector<node *> stack_;
+
+            // Push the path of nodes not smaller than lo, the smallest one on top.
+            void descend(node *n) {
+                while (n) {
+                    tree_.statistics(false, false);
+                    if (less(n->key(), lo_)) {
+                        n = n->right;
+                    } else {
+                        stack_.push_back(n);
+                        n = n->left;
+                    }
+                }
+            }
+        };
+
+        /*
+         * In-order enumeration of a subtree with an explicit stack, in the
+         * order of inorder_dfs -- from the largest to the smallest key. The
+         * stack keeps nodes whose left subtree is pending, so it is as deep
+         * as the subtree and lives on the heap instead of the call stack.
+         */
+        template<typename Node>
+        class inorder_iterator {
+        public:
+            explicit inorder_iterator(Node *root) {
+                stack_.reserve(64);
+                push_right_path(root);
+            }
+
+            /*
+             * Return next node or nullptr when the subtree is exhausted.
+             */
+            Node *next() {
+                if (stack_.empty())
+                    return nullptr;
+                Node *n = stack_.back();
+                stack_.pop_back();
+                push_right_path(n->left);
+                return n;
+            }
+
+        private:
+            std::vector<Node *> stack_;
+
+            void push_right_path(Node *n) {
+                for (; n; n = n->right) {
+                    // The left child is needed when the node is popped.
+                    __builtin_prefetch(n->left);
+                    stack_.push_back(n);
+                }
             }
         };
 
         struct {
             bool operator()(node *a, node *b) const {
-                return a->value > b->value;
+                return less(b->key(), a->key());
             }
         } node_comparator;
 
     public:
         node *tree = nullptr;
-        const double alpha;
+        double alpha;  // Changes only in the adaptive mode, see adapt_alpha.
         statistics_& stats;
         int_least32_t elements_count = 0;
+        // Rebuilds of subtrees larger than the cutoff use up to this many threads.
+        unsigned rebuild_threads = 1;
+        static constexpr int_least32_t parallel_rebuild_cutoff = 1 << 15;
 
         explicit bbalpha(double a, statistics_& s) : alpha(a), stats(s) {}
         bbalpha(const bbalpha &other) = delete;
@@ -86,7 +362,9 @@ namespace rt {
         tree(other.tree),
         alpha(other.alpha),
         stats(other.stats),
-        elements_count(other.elements_count) {
+        elements_count(other.elements_count),
+        rebuild_threads(other.rebuild_threads),
+        adaptive_(std::move(other.adaptive_)) {
             other.tree = nullptr;
             other.elements_count = 0;
         }
@@ -96,36 +374,35 @@ namespace rt {
             alpha = other.alpha;
             stats = other.stats;
             elements_count = other.elements_count;
+            rebuild_threads = other.rebuild_threads;
+            adaptive_ = std::move(other.adaptive_);
             other.tree = nullptr;
             other.elements_count = 0;
             return *this;
         }
 
-        void statistics(const bool insert, const bool operation_end) noexcept {
-            if (insert) {
-                if (operation_end) {
-                    if (stats.last_insert_visits > stats.max_insert_visits)
-                        stats.max_insert_visits = stats.last_insert_visits;
-                    stats.last_insert_visits = 0;
-                    ++stats.insert_calls;
-                }
-                else {
-                    ++stats.last_insert_visits;
-                    ++stats.insert_visits;
-                }
-            }
-            else {
-                if (operation_end) {
-                    if (stats.last_range_count_visits > stats.max_range_count_visits)
-                        stats.max_range_count_visits = stats.last_range_count_visits;
-                    stats.last_range_count_visits = 0;
-                    ++stats.range_count_calls;
-                }
-                else {
-                    ++stats.last_range_count_visits;
-                    ++stats.range_count_visits;
-                }
-            }
+        /*
+         * Switch to the adaptive mode, in which alpha is retuned within
+         * [min_alpha, max_alpha] after every rebuild to minimize the total
+         * work. Visits in stats since the previous retuning (of all trees
+         * sharing them) are split into search visits (range_count visits and
+         * insert visits outside of rebuilds), which grow with the expected
+         * depth (see height_factor), and rebuild visits, which fall as
+         * 1 / (2 alpha - 1) since a subtree of size m is rebuilt after
+         * (2 alpha - 1) m / 2 inserts into it at the earliest. Both are scaled
+         * to the alpha they were observed with, smoothed over retunings, and
+         * alpha minimizing their sum is chosen.
+         */
+        void adapt_alpha(const double min_alpha, const double max_alpha) {
+            if (!(0.5 < min_alpha && min_alpha <= max_alpha && max_alpha < 1))
+                throw std::invalid_argument("Alpha limits must satisfy 0.5 < min_alpha <= max_alpha < 1.");
+            adaptive_.reset(new adaptive_state{min_alpha, max_alpha, -1, -1, stats.rebuild_visits,
+                                               stats.insert_visits, stats.range_count_visits});
+            alpha = std::min(std::max(alpha, min_alpha), max_alpha);
+        }
+
+        void statistics(const bool insert, const bool operation_end, const uint_least32_t visits = 1) noexcept {
+            stats.record(insert, operation_end, visits);
         }
 
         virtual ~bbalpha() {
@@ -143,18 +420,42 @@ namespace rt {
 
         /*
          * Simple recursive tree building. Array must be sorted and contain
-         * element_count number of elements.
+         * element_count number of elements. It visits end - begin nodes,
+         * the caller records them at once, so that the building may run
+         * in parallel.
          */
         node *build_t(node **array, node *parent_of_sequence, const int_least32_t begin, const int_least32_t end) {
             if (!array || begin >= end)
                 return nullptr;
-            statistics(true, false);
             int_least32_t half = begin + int_least32_t((end - begin) / 2);
             node *n = array[half];
             n->parent = parent_of_sequence;
             n->subtree_size = end - begin;
             n->right = build_t(array, n, begin, half);
             n->left = build_t(array, n, half + 1, end);
+            update_aggregate(n);
+            return n;
+        }
+
+        /*
+         * Fork-join variant of build_t, sequences longer than
+         * parallel_rebuild_cutoff have their halves built by separate
+         * threads, up to thread_count threads in total.
+         */
+        node *build_t_parallel(node **array, node *parent_of_sequence, const int_least32_t begin,
+                               const int_least32_t end, const unsigned thread_count) {
+            if (thread_count < 2 || end - begin < parallel_rebuild_cutoff)
+                return build_t(array, parent_of_sequence, begin, end);
+            int_least32_t half = begin + int_least32_t((end - begin) / 2);
+            node *n = array[half];
+            n->parent = parent_of_sequence;
+            n->subtree_size = end - begin;
+            std::thread right([=]() {
+                n->right = build_t_parallel(array, n, begin, half, thread_count / 2);
+            });
+            n->left = build_t_parallel(array, n, half + 1, end, thread_count - thread_count / 2);
+            right.join();
+            update_aggregate(n);
             return n;
         }
 
@@ -168,7 +469,8 @@ namespace rt {
                 node *new_node = new node(array[i]);
                 ptrs[i] = new_node;
             }
-            auto n = build_t(ptrs, nullptr, 0, element_count);
+            auto n = build_t_parallel(ptrs, nullptr, 0, element_count, rebuild_threads);
+            statistics(true, false, uint_least32_t(element_count));
             delete[] ptrs;  // Deallocate only the array, not nodes themselves.
             return n;
         }
@@ -182,13 +484,120 @@ namespace rt {
          * node's subtree is rebuild to perfectly balanced analogy.
          */
         node *insert(const T &val) {
+            return insert_node(new node(val));
+        }
+
+        node *insert(T &&val) {
+            return insert_node(new node(std::move(val)));
+        }
+
+        /*
+         * Call f on every node with lo <= value <= hi in ascending order, but
+         * on at most limit of them (early exit for "first k" queries). Returns
+         * number of reported nodes.
+         */
+        template<typename Lambda>
+        int_least32_t range_report(const key_type &lo, const key_type &hi, Lambda &&f,
+                                   const int_least32_t limit = std::numeric_limits<int_least32_t>::max()) {
+            range_iterator it(*this, lo, hi);
+            int_least32_t reported = 0;
+            node *n;
+            while (reported < limit && (n = it.next())) {
+                f(n);
+                ++reported;
+            }
+            statistics(false, true);
+            return reported;
+        }
+
+        /*
+         * Return number of nodes with lo <= value <= hi.
+         */
+        int_least32_t range_count(const key_type &lo, const key_type &hi) {
+            int_least32_t count = (less(hi, lo)) ? 0 : rank(hi, true) - rank(lo, false);
+            statistics(false, true);
+            return count;
+        }
+
+        /*
+         * Return node with value equal to x or nullptr. Visits count as range
+         * count visits.
+         */
+        node *find(const key_type &x) {
+            node *ptr = tree;
+            while (ptr) {
+                statistics(false, false);
+                if (less(x, ptr->key()))
+                    ptr = ptr->left;
+                else if (less(ptr->key(), x))
+                    ptr = ptr->right;
+                else
+                    break;
+            }
+            statistics(false, true);
+            return ptr;
+        }
+
+        /*
+         * Return combined aggregate of values lo <= value <= hi, combined in
+         * ascending order of the values.
+         */
+        aggregate_type range_aggregate(const key_type &lo, const key_type &hi) {
+            aggregate_type result = aggregate_between(lo, hi);
+            statistics(false, true);
+            return result;
+        }
+
+        /*
+         * Call f on nodes of the subtree of n -- right subtree, the node, left
+         * subtree.
+         */
+        template<typename Node, typename Lambda>
+        void inorder_dfs(Node *n, Lambda &&f) {
+            inorder_iterator<Node> it(n);
+            while ((n = it.next()))
+                f(n);
+        }
+
+        /*
+         * Call f on nodes of the subtree of n -- right subtree, left subtree,
+         * the node. Iterative, a node is left to f once both its subtrees
+         * are done, which the last finished node tells.
+         */
+        template<typename Node, typename Lambda>
+        void postorder_dfs(Node *n, Lambda &&f) {
+            std::vector<Node *> stack;
+            Node *last = nullptr;
+            while (n || !stack.empty()) {
+                if (n) {
+                    stack.push_back(n);
+                    n = n->right;
+                    continue;
+                }
+                Node *top = stack.back();
+                if (top->left && top->left != last) {
+                    n = top->left;
+                    continue;
+                }
+                stack.pop_back();
+                f(top);
+                last = top;
+            }
+        }
+
+    protected:
+        static bool less(const key_type &a, const key_type &b) noexcept {
+            return Compare()(a, b);
+        }
+
+        node *insert_node(node *to_insert) {
             node *node_to;
             node **insertion_place;
-            std::tie(node_to, insertion_place) = insert_find(val);
+            std::tie(node_to, insertion_place) = insert_find(to_insert->key());
             // Firstly, trivially insert the new node, possibly violating the tree invariant.
             // If we inserted the very first node in the tree, we end.
-            node *to_insert = new node(val);
             statistics(true, false);
+            update_aggregate(to_insert);
             if (trivial_insert(node_to, insertion_place, to_insert) == tree)
                 return tree;
             // Update subtree sizes above inserted node, track unbalanced nodes.
@@ -196,70 +605,192 @@ namespace rt {
             // If there is any unbalanced node, the following condition is true
             // and by rebuilding only highest_unbalanced we balance the whole tree at once.
             if (highest_unbalanced) {
-                int_least32_t size = highest_unbalanced->subtree_size;
-                // Rebuild the ptr subtree.
-                node **array = new node *[size];
-                // For rebuilding, sorted nodes are necessary.
-                sort_tree(array, highest_unbalanced);
-#ifndef NDEBUG
-                assert_correct_sorting(array, size);
-#endif
-                // Correctly hang rebuilt tree.
-                node **address_of_ptr_to_highest_unbalanced = highest_unbalanced->parent_ptr_address();
-                if (!address_of_ptr_to_highest_unbalanced)
-                    address_of_ptr_to_highest_unbalanced = &tree;
-                *address_of_ptr_to_highest_unbalanced = build_t(array, highest_unbalanced->parent, 0, size);
-
-                delete[] array;
+                const uint_least32_t visits_before = stats.insert_visits;
+                rebuild(highest_unbalanced);
+                stats.rebuild_visits += stats.insert_visits - visits_before;
+                retune_alpha();
             }
             return *insertion_place;
         }
 
-        template<typename Node, typename Lambda>
-        void inorder_dfs(Node *n, Lambda &&f) {
-            if (!n)
+        // See adapt_alpha, nothing happens outside of the adaptive mode.
+        void retune_alpha() noexcept {
+            if (!adaptive_)
                 return;
-            inorder_dfs(n->right, f);
-            f(n);
-            inorder_dfs(n->left, f);
+            // Counters may wrap around, differences stay correct.
+            const uint_least32_t inserts = stats.insert_visits - adaptive_->seen_insert_visits;
+            const uint_least32_t queries = stats.range_count_visits - adaptive_->seen_range_count_visits;
+            adaptive_->seen_insert_visits = stats.insert_visits;
+            adaptive_->seen_range_count_visits = stats.range_count_visits;
+            const uint_least32_t rebuilds = std::min(stats.rebuild_visits - adaptive_->seen_rebuild_visits, inserts);
+            adaptive_->seen_rebuild_visits = stats.rebuild_visits;
+            // Work of the window as it would be with alpha giving height and rebuild factors 1.
+            const double search = double(inserts - rebuilds + queries) / height_factor(alpha);
+            const double rebuild = double(rebuilds) * (2 * alpha - 1);
+            adaptive_->search_work = (adaptive_->search_work < 0) ? search : (adaptive_->search_work + search) / 2;
+            adaptive_->rebuild_work = (adaptive_->rebuild_work < 0) ? rebuild : (adaptive_->rebuild_work + rebuild) / 2;
+            constexpr int steps = 64;
+            double best_work = std::numeric_limits<double>::max();
+            for (int i = 0; i <= steps; ++i) {
+                const double a = adaptive_->min_alpha + (adaptive_->max_alpha - adaptive_->min_alpha) * i / steps;
+                const double work = adaptive_->search_work * height_factor(a) + adaptive_->rebuild_work / (2 * a - 1);
+                if (work < best_work) {
+                    best_work = work;
+                    alpha = a;
+                }
+            }
         }
 
-        template<typename Node, typename Lambda>
-        void postorder_dfs(Node *n, Lambda &&f) {
-            if (!n)
-                return;
-            postorder_dfs(n->right, f);
-            postorder_dfs(n->left, f);
-            f(n);
+        /*
+         * Expected depth of BB[alpha] tree relative to log2 n, assuming the
+         * larger child of a node takes (1/2 + alpha) / 2 of its size on
+         * average, halfway between a fresh rebuild and the next one.
+         */
+        static double height_factor(const double a) noexcept {
+            const double b = (0.5 + a) / 2;
+            return -1 / (b * std::log2(b) + (1 - b) * std::log2(1 - b));
+        }
+
+        /*
+         * Rebuild the subtree of n to a perfectly balanced one, hang it in
+         * place of n and return its new root. Trees keeping additional data
+         * in their nodes override this to refresh the data after rebuild.
+         */
+        virtual node *rebuild(node *n) {
+            int_least32_t size = n->subtree_size;
+            // Rebuild the ptr subtree.
+            node **array = new node *[size];
+            // For rebuilding, sorted nodes are necessary.
+            sort_tree(array, n);
+#ifndef NDEBUG
+            assert_correct_sorting(array, size);
+#endif
+            // Correctly hang rebuilt tree.
+            node **address_of_ptr_to_n = n->parent_ptr_address();
+            if (!address_of_ptr_to_n)
+                address_of_ptr_to_n = &tree;
+            *address_of_ptr_to_n = build_t_parallel(array, n->parent, 0, size, rebuild_threads);
+            statistics(true, false, uint_least32_t(size));
+            node *new_root = *address_of_ptr_to_n;
+
+            delete[] array;
+            return new_root;
+        }
+
+        /*
+         * Return number of nodes with value < x (value <= x if inclusive).
+         * Untracked calls do not write anything and may run concurrently.
+         */
+        template<bool Tracked = true>
+        int_least32_t rank(const key_type &x, const bool inclusive) {
+            return subtree_rank(tree, x, inclusive, [this]() {
+                if (Tracked)
+                    statistics(false, false);
+            });
+        }
+
+    public:
+        /*
+         * Return number of nodes of the subtree of ptr with value < x (value
+         * <= x if inclusive) by summing sizes of smaller (left) subtrees
+         * along the search path, call visit() on every node of the path.
+         * Takes any node with right, left, subtree_size and key(), so trees
+         * of other node layouts count the same way.
+         */
+        template<typename Node, typename Visit>
+        static int_least32_t subtree_rank(const Node *ptr, const key_type &x, const bool inclusive, Visit &&visit) {
+            int_least32_t r = 0;
+            while (ptr) {
+                visit();
+                __builtin_prefetch(ptr->right);
+                __builtin_prefetch(ptr->left);
+                // Selected by arithmetic and conditional moves, no branch to mispredict.
+                const bool right = less(ptr->key(), x) | (inclusive & !less(x, ptr->key()));
+                const int_least32_t left_size = (ptr->left) ? ptr->left->subtree_size : 0;
+                r += int_least32_t(right) * (1 + left_size);
+                ptr = (right) ? ptr->right : ptr->left;
+            }
+            return r;
         }
 
     protected:
+        static aggregate_type aggregate_of(const node *n) noexcept {
+            return (n) ? n->aggregate() : Aggregate::identity();
+        }
+
+        /*
+         * Recompute aggregate of n from its children, which must be up to date.
+         */
+        static void update_aggregate(node *n) noexcept {
+            n->set_aggregate(Aggregate::combine(
+                    Aggregate::combine(aggregate_of(n->left), Aggregate::of(n->value)),
+                    aggregate_of(n->right)));
+        }
+
+        /*
+         * Find the split node of [lo, hi] and combine aggregates of subtrees
+         * hanging inside of the range along both paths from it. Pieces on the
+         * lower path come in descending order, so they are prepended.
+         */
+        aggregate_type aggregate_between(const key_type &lo, const key_type &hi) {
+            node *split = tree;
+            while (split) {
+                statistics(false, false);
+                if (less(split->key(), lo))
+                    split = split->right;
+                else if (less(hi, split->key()))
+                    split = split->left;
+                else
+                    break;
+            }
+            if (!split)
+                return Aggregate::identity();
+            aggregate_type lower = Aggregate::identity();
+            for (node *v = split->left; v;) {
+                statistics(false, false);
+                if (!less(v->key(), lo)) {
+                    lower = Aggregate::combine(Aggregate::combine(Aggregate::of(v->value), aggregate_of(v->right)), lower);
+                    v = v->left;
+                } else {
+                    v = v->right;
+                }
+            }
+            aggregate_type upper = Aggregate::identity();
+            for (node *v = split->right; v;) {
+                statistics(false, false);
+                if (!less(hi, v->key())) {
+                    upper = Aggregate::combine(upper, Aggregate::combine(aggregate_of(v->left), Aggregate::of(v->value)));
+                    v = v->right;
+                } else {
+                    v = v->left;
+                }
+            }
+            return Aggregate::combine(Aggregate::combine(lower, Aggregate::of(split->value)), upper);
+        }
+
         // Returns address of place where to insert pointer to inserted node +
         // pointer to the newly parental node.
         // Ignores duplicities, always finds a place for insertion
-        auto insert_find(const T &node_data) noexcept {
+        auto insert_find(const key_type &node_data) noexcept {
             node *ptr = tree;
             node *pre_ptr = nullptr;
             node **insertion_place = nullptr;
             while (ptr != nullptr) {
                 statistics(true, false);
-                const auto &current_data = ptr->value;
-                if (current_data <= node_data) {
-                    insertion_place = &(ptr->right);
-                    pre_ptr = ptr;
-                    ptr = ptr->right;
-                } else {
-                    insertion_place = &(ptr->left);
-                    pre_ptr = ptr;
-                    ptr = ptr->left;
-                }
+                // Both children are fetched while the key is compared.
+                __builtin_prefetch(ptr->right);
+                __builtin_prefetch(ptr->left);
+                const bool right = !less(node_data, ptr->key());
+                insertion_place = (right) ? &(ptr->right) : &(ptr->left);
+                pre_ptr = ptr;
+                ptr = *insertion_place;
             }
             return std::make_tuple(pre_ptr, insertion_place);
         }
 
         /*
          * Goes from the from node to the root node, updating subtree sizes
-         * along the way up after node insertion by adding 1 and track highest
+         * (and aggregates) along the way up after node insertion by adding 1 and track highest
          * unbalanced node in the tree (the closest one to the root).
          */
         node *update_subtree_sizes_from_node_to_root(node *from) noexcept {
@@ -268,6 +799,7 @@ namespace rt {
             while (ptr) {
                 statistics(true, false);
                 ++(ptr->subtree_size);
+                update_aggregate(ptr);
                 int_least32_t r_size = (ptr->right) ? ptr->right->subtree_size : 0;
                 int_least32_t l_size = (ptr->left) ? ptr->left->subtree_size : 0;
                 int_least32_t size = ptr->subtree_size;
@@ -304,14 +836,25 @@ namespace rt {
          * pointers to nodes in sorted order (from smallest to largest values).
          */
         void sort_tree(node **out_sorted_array, node *root_of_tree_to_sort) {
+            inorder_iterator<node> it(root_of_tree_to_sort);
             int_least32_t idx = 0;
-            inorder_dfs(root_of_tree_to_sort, [=, &idx](auto n) {
-                this->statistics(true, false);
+            for (node *n; (n = it.next()); ++idx)
                 out_sorted_array[idx] = n;
-                ++idx;
-            });
+            statistics(true, false, uint_least32_t(idx));
         }
 
+        struct adaptive_state {
+            double min_alpha;
+            double max_alpha;
+            double search_work;
+            double rebuild_work;
+            uint_least32_t seen_rebuild_visits;
+            uint_least32_t seen_insert_visits;
+            uint_least32_t seen_range_count_visits;
+        };
+        // Null outside of the adaptive mode, lower trees of range_tree do not pay for it.
+        std::unique_ptr<adaptive_state> adaptive_;
+
 #ifndef NDEBUG
 
         /*
@@ -0,0 +1,323 @@
+#ifndef DATA_STRUCTURES_BLOCKED_KEYS_H
+#define DATA_STRUCTURES_BLOCKED_KEYS_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace rt {
+
+    /*
+     * Number of leading elements of sorted array a of length n satisfying
+     * pred, which must hold for a prefix of the array. The halving loop has
+     * no data-dependent branch, the comparison selects the next base by a
+     * conditional move, and it always takes ceil(log2 n) steps.
+     */
+    template<typename K, typename Pred>
+    size_t branchless_count(const K *a, size_t n, Pred &&pred) noexcept {
+        if (n == 0)
+            return 0;
+        const K *base = a;
+        while (n > 1) {
+            const size_t half = n / 2;
+            base = pred(base[half]) ? base + half : base;
+            n -= half;
+        }
+        return size_t(base - a) + (pred(*base) ? 1 : 0);
+    }
+
+    /*
+     * Sorted multiset of keys supporting insert, rank and access by rank,
+     * the compact replacement of the last level of range tree. Up to
+     * block_size^2 keys are one packed sorted array. Larger sets are a
+     * B+-tree of such arrays -- nodes hold up to block_size children with
+     * the first key and the number of keys of every child, nodes of the
+     * bottom level hold the arrays themselves. Rank is a branchless search
+     * over the first keys of each node on the path, summing counts of the
+     * children before the chosen one, and then within one array. Insert
+     * changes only the nodes on its path, a full array or node is split in
+     * two and its parent gets one more child, so an update moves
+     * O(block_size^2) keys regardless of the set size.
+     */
+    template<typename K>
+    class blocked_keys {
+    public:
+        explicit blocked_keys(const int_least32_t block_size) : block_size_(block_size) {
+            if (block_size < 2)
+                throw std::invalid_argument("Block size must be at least 2.");
+        }
+
+        int_least32_t size() const noexcept { return size_; }
+
+        /*
+         * Number of keys < x, or <= x if inclusive.
+         */
+        int_least32_t rank(const K &x, const bool inclusive) const noexcept {
+            return (inclusive) ? rank_of([&x](const K &k) { return !(x < k); })
+                               : rank_of([&x](const K &k) { return k < x; });
+        }
+
+        /*
+         * The i-th smallest key, i < size().
+         */
+        const K &at(int_least32_t i) const noexcept {
+            if (!root_)
+                return keys_[size_t(i)];
+            const node *n = root_.get();
+            while (true) {
+                size_t c = 0;
+                for (; i >= n->counts[c]; ++c)
+                    i -= n->counts[c];
+                if (n->bottom())
+                    return n->leaves[c][size_t(i)];
+                n = n->children[c].get();
+            }
+        }
+
+        /*
+         * Number of probes one search takes, for statistics.
+         */
+        uint_least32_t search_depth() const noexcept {
+            if (!root_)
+                return ceil_log2(keys_.size());
+            uint_least32_t levels = 3;
+            for (const node *n = root_.get(); !n->bottom(); n = n->children.front().get())
+                ++levels;
+            return levels * ceil_log2(size_t(block_size_));
+        }
+
+        void insert(const K &x) {
+            auto not_greater = [&x](const K &k) { return !(x < k); };
+            ++size_;
+            if (!root_) {
+                if (keys_.size() < leaf_size()) {
+                    keys_.insert(keys_.begin() + branchless_count(keys_.data(), keys_.size(), not_greater), x);
+                    return;
+                }
+                // The packed array becomes the only leaf.
+                root_ = std::make_unique<node>();
+                root_->keys.push_back(keys_.front());
+                root_->counts.push_back(int_least32_t(keys_.size()));
+                root_->leaves.push_back(std::move(keys_));
+                keys_ = std::vector<K>();
+            }
+            // Nodes and child positions on the path to the leaf.
+            std::vector<std::pair<node *, size_t>> path;
+            node *n = root_.get();
+            while (true) {
+                const size_t c = child_of(*n, not_greater);
+                path.emplace_back(n, c);
+                ++n->counts[c];
+                if (n->bottom())
+                    break;
+                n = n->children[c].get();
+            }
+            const size_t c = path.back().second;
+            std::vector<K> &leaf = n->leaves[c];
+            const size_t position = branchless_count(leaf.data(), leaf.size(), not_greater);
+            leaf.insert(leaf.begin() + position, x);
+            // A new smallest key of a leaf is the first key of its ancestors too.
+            for (size_t i = path.size(); position == 0 && i-- > 0;) {
+                path[i].first->keys[path[i].second] = x;
+                if (path[i].second != 0)
+                    break;
+            }
+            if (leaf.size() > leaf_size()) {
+                const size_t half = leaf.size() / 2;
+                std::vector<K> upper(leaf.begin() + half, leaf.end());
+                leaf.resize(half);
+                leaf.shrink_to_fit();
+                n->counts[c] = int_least32_t(half);
+                const K first = upper.front();
+                const int_least32_t moved = int_least32_t(upper.size());
+                n->keys.insert(n->keys.begin() + (c + 1), first);
+                n->counts.insert(n->counts.begin() + (c + 1), moved);
+                n->leaves.insert(n->leaves.begin() + (c + 1), std::move(upper));
+            }
+            // Split overflowing nodes bottom-up.
+            for (size_t i = path.size() - 1; n->keys.size() > size_t(block_size_); n = path[--i].first) {
+                std::unique_ptr<node> sibling = split(*n);
+                const K first = sibling->keys.front();
+                const int_least32_t moved = count_of(*sibling);
+                if (i == 0) {
+                    std::unique_ptr<node> root = std::make_unique<node>();
+                    root->keys.push_back(root_->keys.front());
+                    root->counts.push_back(count_of(*root_));
+                    root->children.push_back(std::move(root_));
+                    root_ = std::move(root);
+                    add_child(*root_, first, moved, std::move(sibling));
+                    break;
+                }
+                node &parent = *path[i - 1].first;
+                const size_t p = path[i - 1].second;
+                parent.counts[p] -= moved;
+                parent.keys.insert(parent.keys.begin() + (p + 1), first);
+                parent.counts.insert(parent.counts.begin() + (p + 1), moved);
+                parent.children.insert(parent.children.begin() + (p + 1), std::move(sibling));
+            }
+        }
+
+        /*
+         * Replace the content by keys from the ascending range [begin, end),
+         * arrays and nodes are filled completely.
+         */
+        template<typename Iterator>
+        void assign(Iterator begin, Iterator end) {
+            keys_.assign(begin, end);
+            size_ = int_least32_t(keys_.size());
+            root_.reset();
+            if (keys_.size() <= leaf_size()) {
+                keys_.shrink_to_fit();
+                return;
+            }
+            const size_t bs = size_t(block_size_), n = keys_.size();
+            std::vector<std::unique_ptr<node>> level;
+            for (size_t s = 0; s < n; s += leaf_size()) {
+                if (s % (leaf_size() * bs) == 0)
+                    level.push_back(new_node(std::min(bs, (n - s + leaf_size() - 1) / leaf_size()), true));
+                const size_t e = std::min(s + leaf_size(), n);
+                node &bottom = *level.back();
+                bottom.keys.push_back(keys_[s]);
+                bottom.counts.push_back(int_least32_t(e - s));
+                bottom.leaves.emplace_back(keys_.begin() + s, keys_.begin() + e);
+            }
+            keys_ = std::vector<K>();
+            while (level.size() > 1) {
+                std::vector<std::unique_ptr<node>> parents;
+                for (size_t c = 0; c < level.size(); ++c) {
+                    if (c % bs == 0)
+                        parents.push_back(new_node(std::min(bs, level.size() - c), false));
+                    const K first = level[c]->keys.front();
+                    const int_least32_t count = count_of(*level[c]);
+                    add_child(*parents.back(), first, count, std::move(level[c]));
+                }
+                level.swap(parents);
+            }
+            root_ = std::move(level.front());
+        }
+
+        // Bytes taken by the object, its arrays and nodes.
+        size_t memory_footprint() const noexcept {
+            size_t bytes = sizeof(*this) + keys_.capacity() * sizeof(K);
+            std::vector<const node *> stack;
+            if (root_)
+                stack.push_back(root_.get());
+            while (!stack.empty()) {
+                const node *n = stack.back();
+                stack.pop_back();
+                bytes += sizeof(node) + n->keys.capacity() * sizeof(K) +
+                         n->counts.capacity() * sizeof(int_least32_t) +
+                         n->children.capacity() * sizeof(std::unique_ptr<node>) +
+                         n->leaves.capacity() * sizeof(std::vector<K>);
+                for (const auto &leaf : n->leaves)
+                    bytes += leaf.capacity() * sizeof(K);
+                for (const auto &c : n->children)
+                    stack.push_back(c.get());
+            }
+            return bytes;
+        }
+
+    private:
+        /*
+         * Node of the B+-tree, with the first key and the number of keys of
+         * every child. Children of a bottom node are sorted arrays.
+         */
+        struct node {
+            std::vector<K> keys;
+            std::vector<int_least32_t> counts;
+            std::vector<std::unique_ptr<node>> children;
+            std::vector<std::vector<K>> leaves;
+
+            bool bottom() const noexcept { return children.empty(); }
+        };
+
+        const int_least32_t block_size_;
+        int_least32_t size_ = 0;
+        // The packed array, empty once the keys are in the B+-tree.
+        std::vector<K> keys_;
+        std::unique_ptr<node> root_;
+
+        size_t leaf_size() const noexcept { return size_t(block_size_) * size_t(block_size_); }
+
+        static uint_least32_t ceil_log2(size_t n) noexcept {
+            uint_least32_t log = 0;
+            while ((size_t(1) << log) < n)
+                ++log;
+            return log;
+        }
+
+        static std::unique_ptr<node> new_node(const size_t children, const bool bottom) {
+            std::unique_ptr<node> n = std::make_unique<node>();
+            n->keys.reserve(children);
+            n->counts.reserve(children);
+            if (bottom)
+                n->leaves.reserve(children);
+            else
+                n->children.reserve(children);
+            return n;
+        }
+
+        static int_least32_t count_of(const node &n) noexcept {
+            int_least32_t count = 0;
+            for (const int_least32_t c : n.counts)
+                count += c;
+            return count;
+        }
+
+        // The last child whose first key satisfies pred, or the first child.
+        template<typename Pred>
+        static size_t child_of(const node &n, Pred &&pred) noexcept {
+            const size_t j = branchless_count(n.keys.data(), n.keys.size(), pred);
+            return (j > 0) ? j - 1 : 0;
+        }
+
+        template<typename Pred>
+        int_least32_t rank_of(Pred &&pred) const noexcept {
+            if (!root_)
+                return int_least32_t(branchless_count(keys_.data(), keys_.size(), pred));
+            int_least32_t r = 0;
+            const node *n = root_.get();
+            while (true) {
+                const size_t c = child_of(*n, pred);
+                for (size_t i = 0; i < c; ++i)
+                    r += n->counts[i];
+                if (n->bottom())
+                    return r + int_least32_t(branchless_count(n->leaves[c].data(), n->leaves[c].size(), pred));
+                n = n->children[c].get();
+            }
+        }
+
+        static void add_child(node &parent, const K &first, const int_least32_t count, std::unique_ptr<node> child) {
+            parent.keys.push_back(first);
+            parent.counts.push_back(count);
+            parent.children.push_back(std::move(child));
+        }
+
+        // Move the upper half of the children of the overflowing node n to a new node and return it.
+        static std::unique_ptr<node> split(node &n) {
+            const size_t half = n.keys.size() / 2;
+            std::unique_ptr<node> upper = std::make_unique<node>();
+            if (n.bottom()) {
+                upper->leaves.assign(std::make_move_iterator(n.leaves.begin() + half),
+                                     std::make_move_iterator(n.leaves.end()));
+                n.leaves.resize(half);
+            } else {
+                upper->children.assign(std::make_move_iterator(n.children.begin() + half),
+                                       std::make_move_iterator(n.children.end()));
+                n.children.resize(half);
+            }
+            upper->keys.assign(n.keys.begin() + half, n.keys.end());
+            upper->counts.assign(n.counts.begin() + half, n.counts.end());
+            n.keys.resize(half);
+            n.counts.resize(half);
+            return upper;
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_BLOCKED_KEYS_H
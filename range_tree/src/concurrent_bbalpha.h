@@ -0,0 +1,103 @@
+#ifndef DATA_STRUCTURES_CONCURRENT_BBALPHA_H
+#define DATA_STRUCTURES_CONCURRENT_BBALPHA_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+#include "bbalpha_tree.h"
+#include "persistent_bbalpha.h"
+#include "epoch.h"
+
+namespace rt {
+
+    /*
+     * Versions of a persistent tree -- persistent_bbalpha or
+     * persistent_range_tree -- for one writer and many lock-free readers.
+     * The writer inserts into the latest version, which leaves it
+     * untouched, and publishes the new one with one atomic store of a
+     * pointer. The replaced version is retired to epoch-based reclamation,
+     * and once no reader can still hold it, destroying it frees the nodes
+     * no later version shares.
+     */
+    template<typename Version>
+    class concurrent_versions {
+    public:
+        /*
+         * Reading handle, every reader thread must use its own one. Range
+         * count visits are recorded to the reader's own statistics.
+         */
+        class reader {
+        public:
+            statistics_ stats;
+
+            explicit reader(concurrent_versions &t) : tree_(t), slot_(t.epochs_.register_reader()) {}
+            reader(const reader &other) = delete;
+            reader &operator=(const reader &other) = delete;
+            ~reader() {
+                tree_.epochs_.unregister_reader(slot_);
+            }
+
+            /*
+             * Return range count of the latest published version, with the
+             * arguments of Version::range_count.
+             */
+            template<typename... Args>
+            int_least32_t range_count(const Args &... args) {
+                epoch_manager::guard g(tree_.epochs_, slot_);
+                return tree_.latest_.load()->range_count(args..., stats);
+            }
+
+            // Number of elements in the latest published version.
+            int_least32_t size() {
+                epoch_manager::guard g(tree_.epochs_, slot_);
+                return tree_.latest_.load()->elements_count();
+            }
+
+        private:
+            concurrent_versions &tree_;
+            const size_t slot_;
+        };
+
+        statistics_ &stats;  // Writer statistics.
+
+        concurrent_versions(double alpha, statistics_ &s) : stats(s), latest_(new Version(alpha, s)) {}
+        concurrent_versions(const concurrent_versions &other) = delete;
+        concurrent_versions &operator=(const concurrent_versions &other) = delete;
+
+        ~concurrent_versions() {
+            delete latest_.load();
+        }
+
+        /*
+         * Writer only. Insert with the arguments of Version::insert,
+         * publish the new version and retire the old one.
+         */
+        template<typename... Args>
+        void insert(const Args &... args) {
+            Version *old = latest_.load();
+            latest_.store(new Version(old->insert(args...)));
+            epochs_.retire(old);
+            epochs_.collect();
+            stats.record(true, true);
+        }
+
+        // Writer only.
+        int_least32_t elements_count() const noexcept { return latest_.load()->elements_count(); }
+
+        // Number of retired versions not freed yet.
+        size_t pending_reclamation() const noexcept { return epochs_.retired_count(); }
+
+    private:
+        std::atomic<Version *> latest_;
+        epoch_manager epochs_;
+    };
+
+    template<typename T>
+    using concurrent_bbalpha = concurrent_versions<persistent_bbalpha<T>>;
+
+    template<typename Coord = int_least32_t>
+    using concurrent_range_tree = concurrent_versions<persistent_range_tree<Coord>>;
+
+}
+
+#endif //DATA_STRUCTURES_CONCURRENT_BBALPHA_H
@@ -0,0 +1,122 @@
+#ifndef DATA_STRUCTURES_EPOCH_H
+#define DATA_STRUCTURES_EPOCH_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+
+namespace rt {
+
+    /*
+     * Epoch-based reclamation for one writer and up to max_readers readers.
+     * A reader pins the current global epoch while it reads shared memory.
+     * The writer retires unlinked objects with the current epoch, and it
+     * may free them once the global epoch has advanced twice. The epoch only
+     * advances after every pinned reader has seen the current one.
+     */
+    class epoch_manager {
+    public:
+        static constexpr size_t max_readers = 64;
+
+        /*
+         * RAII pin of the current epoch, a reader may touch shared objects
+         * only while holding the guard.
+         */
+        class guard {
+        public:
+            guard(epoch_manager &m, const size_t slot) noexcept : m_(m), slot_(slot) {
+                m_.slots_[slot_].epoch.store(m_.global_.load());
+            }
+            guard(const guard &other) = delete;
+            guard &operator=(const guard &other) = delete;
+            ~guard() {
+                m_.slots_[slot_].epoch.store(inactive);
+            }
+
+        private:
+            epoch_manager &m_;
+            const size_t slot_;
+        };
+
+        epoch_manager() = default;
+        epoch_manager(const epoch_manager &other) = delete;
+        epoch_manager &operator=(const epoch_manager &other) = delete;
+
+        ~epoch_manager() {
+            for (auto &r : retired_)
+                r.deleter(r.object);
+        }
+
+        // Reserve a reader slot, throw if all of them are taken.
+        size_t register_reader() {
+            for (size_t i = 0; i < max_readers; ++i) {
+                bool expected = false;
+                if (slots_[i].used.compare_exchange_strong(expected, true))
+                    return i;
+            }
+            throw std::runtime_error("Too many readers.");
+        }
+
+        void unregister_reader(const size_t slot) noexcept {
+            slots_[slot].epoch.store(inactive);
+            slots_[slot].used.store(false);
+        }
+
+        /*
+         * Writer only. The object must be already unreachable for readers
+         * which pin the epoch from now on.
+         */
+        template<typename O>
+        void retire(O *object) {
+            retired_.push_back({object, [](void *o) { delete static_cast<O *>(o); }, global_.load()});
+        }
+
+        /*
+         * Writer only. Try to advance the global epoch and free objects
+         * retired at least two epochs ago.
+         */
+        void collect() {
+            const auto epoch = global_.load();
+            for (size_t i = 0; i < max_readers; ++i) {
+                const auto e = slots_[i].epoch.load();
+                if (e != inactive && e != epoch)
+                    return;
+            }
+            global_.store(epoch + 1);
+            size_t kept = 0;
+            for (auto &r : retired_) {
+                if (r.epoch + 2 <= epoch + 1)
+                    r.deleter(r.object);
+                else
+                    retired_[kept++] = r;
+            }
+            retired_.resize(kept);
+        }
+
+        size_t retired_count() const noexcept { return retired_.size(); }
+
+    private:
+        static constexpr uint_least64_t inactive = ~uint_least64_t(0);
+
+        // Every slot on its own cache line, readers do not share them.
+        struct alignas(64) slot {
+            std::atomic<uint_least64_t> epoch{inactive};
+            std::atomic<bool> used{false};
+        };
+
+        struct retired {
+            void *object;
+            void (*deleter)(void *);
+            uint_least64_t epoch;
+        };
+
+        std::atomic<uint_least64_t> global_{0};
+        slot slots_[max_readers];
+        std::vector<retired> retired_;
+    };
+
+}
+
+#endif //DATA_STRUCTURES_EPOCH_H
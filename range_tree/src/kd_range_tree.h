@@ -0,0 +1,818 @@
+#ifndef DATA_STRUCTURES_KD_RANGE_TREE_H
+#define DATA_STRUCTURES_KD_RANGE_TREE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <array>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <type_traits>
+#include <thread>
+#include <stdexcept>
+#include <functional>
+#include <optional>
+#include <limits>
+#include "bbalpha_tree.h"
+#include "parallel.h"
+#include "blocked_keys.h"
+#include "logarithmic_range_tree.h"
+
+namespace rt {
+
+    template<size_t D, typename Coord = int_least32_t, typename Aggregate = no_aggregate, size_t Full = D>
+    class range_tree;
+
+    /*
+     * Adapts aggregate over point weights to values carrying weight().
+     */
+    template<typename Aggregate>
+    struct weighted_aggregate {
+        using type = typename Aggregate::type;
+        static type identity() noexcept { return Aggregate::identity(); }
+        template<typename V>
+        static type of(const V &v) noexcept { return Aggregate::of(v.weight()); }
+        static type combine(const type &a, const type &b) noexcept { return Aggregate::combine(a, b); }
+    };
+
+    /*
+     * Layered counter of a subtree of a 2D level built by assign or rebuild,
+     * shared by all nodes of the subtree, and the position of the node's own
+     * subtree within it. Reset on every node an insert passes, so only
+     * nodes whose subtrees are unchanged since the build keep it. Other
+     * levels keep nothing.
+     */
+    template<typename Coord, bool = true>
+    struct layered_slot {
+        std::shared_ptr<const layered_range_counter<Coord>> layers;
+        int_least32_t layers_offset = 0;
+    };
+
+    template<typename Coord>
+    struct layered_slot<Coord, false> {};
+
+    /*
+     * Value of a node in the first level of D-dimensional range tree, one of
+     * the levels of a Full-dimensional one. Nodes are keyed by the first
+     * coordinate of the level only (see first_coordinate), lower holds the
+     * range tree over the remaining coordinates of all points in the node's
+     * subtree. The whole point is kept for reporting.
+     */
+    template<size_t D, typename Coord, typename Aggregate, size_t Full = D>
+    struct range_tree_entry :
+            private compressed_value<typename Aggregate::weight_type>, public layered_slot<Coord, D == 2> {
+        using lower_tree = range_tree<D - 1, Coord, Aggregate, Full>;
+        using weight_type = typename Aggregate::weight_type;
+
+        std::array<Coord, Full> point{};
+        std::unique_ptr<lower_tree> lower;
+
+        range_tree_entry() = default;
+        range_tree_entry(const std::array<Coord, Full> &p, const weight_type &w, std::unique_ptr<lower_tree> &&l) :
+                compressed_value<weight_type>(w), point(p), lower(std::move(l)) {}
+
+        decltype(auto) weight() const noexcept { return compressed_value<weight_type>::get(); }
+
+        // The coordinate this level is keyed by.
+        const Coord &coordinate() const noexcept { return point[Full - D]; }
+    };
+
+    /*
+     * Key of the first level entries, kept inline in bbalpha nodes so that
+     * searches do not touch the rest of the point.
+     */
+    struct first_coordinate {
+        template<typename Entry>
+        auto operator()(const Entry &e) const noexcept { return e.coordinate(); }
+    };
+
+    /*
+     * Value of a node in the last level of range tree, the point of Full
+     * coordinates keyed by the last one. Without aggregate a 1D leaf takes
+     * exactly the space of the coordinate.
+     */
+    template<typename Coord, typename Aggregate, size_t Full = 1>
+    struct range_tree_leaf : private compressed_value<typename Aggregate::weight_type> {
+        using weight_type = typename Aggregate::weight_type;
+
+        std::array<Coord, Full> point{};
+
+        range_tree_leaf() = default;
+        range_tree_leaf(const std::array<Coord, Full> &p, const weight_type &w) :
+                compressed_value<weight_type>(w), point(p) {}
+        // Search key for the last coordinate, the others are not compared.
+        range_tree_leaf(const Coord &k) { point[Full - 1] = k; }
+
+        decltype(auto) weight() const noexcept { return compressed_value<weight_type>::get(); }
+
+        const Coord &key() const noexcept { return point[Full - 1]; }
+
+        // The leaf is its own key, an inline copy of the coordinate would take more space.
+        bool operator<(const range_tree_leaf &other) const noexcept { return key() < other.key(); }
+    };
+
+    /*
+     * D-dimensional range tree. The first coordinate is indexed by a bbalpha
+     * tree, every node of which keeps a (D-1)-dimensional range tree of the
+     * remaining coordinates of the points in its subtree. The recursion ends
+     * with range_tree<1>, a plain bbalpha tree over the last coordinate, so
+     * every level is specialized at compile time. All levels share alpha and
+     * statistics, only the outermost level finishes insert/range_count calls.
+     * Lower levels of a Full-dimensional tree are instantiated with the same
+     * Full and keep whole points, so range_report() returns them from any
+     * level.
+     *
+     * Points may carry a weight, range_aggregate() then combines weights of
+     * points within the range by Aggregate, which must be commutative for
+     * D > 1. Only nodes of the last level keep subtree aggregates.
+     *
+     * With compact_block > 0 (trees without aggregate only), the last level
+     * is stored as blocked_keys instead of bbalpha trees -- packed sorted
+     * arrays of coordinates up to compact_block^2 keys and B+-trees of such
+     * arrays with fanout compact_block above it. The last level holds all
+     * but O(n log^(D-2) n) of the entries, so this removes three pointers
+     * and the size from almost every entry, at the cost of an insert there
+     * moving O(compact_block^2) coordinates.
+     *
+     * With layered set, every subtree a 2D level builds by assign or rebuild
+     * also gets a layered_range_counter of its points (see layered_count.h),
+     * shared by its nodes. A count whose split node, or a node on one of the
+     * paths, has an unchanged subtree since then counts the rest of its
+     * subtree within the box by one layered_count in O(log n), instead of
+     * ranks in O(log n) lower trees. Subtrees an insert has passed since
+     * their last rebuild are counted by the lower trees, which are kept
+     * either way. Higher levels pass the switch to their lower trees. It
+     * must be set while the tree is empty.
+     */
+    template<size_t D, typename Coord, typename Aggregate, size_t Full>
+    class range_tree :
+            public bbalpha<range_tree_entry<D, Coord, Aggregate, Full>, no_aggregate, std::less<>, first_coordinate> {
+        static_assert(D > 0, "Range tree must have at least one dimension.");
+        static_assert(D <= Full, "Range tree cannot have more dimensions than its points.");
+        template<size_t, typename, typename, size_t> friend class range_tree;
+
+    public:
+        using base = bbalpha<range_tree_entry<D, Coord, Aggregate, Full>, no_aggregate, std::less<>, first_coordinate>;
+        using node = typename base::node;
+        using entry = range_tree_entry<D, Coord, Aggregate, Full>;
+        using lower_tree = typename entry::lower_tree;
+        using point_type = std::array<Coord, Full>;
+        using weight_type = typename Aggregate::weight_type;
+        using weighted_point = std::pair<point_type, weight_type>;
+        using aggregate_type = typename Aggregate::type;
+
+        struct rect {
+            point_type lo;
+            point_type hi;
+        };
+
+        const int_least32_t compact_block;
+        bool layered = false;
+
+        range_tree(double a, statistics_ &s, const int_least32_t compact = 0) : base(a, s), compact_block(compact) {}
+
+        class report_iterator;
+
+        void insert(const point_type &p, const weight_type &w = weight_type()) {
+            insert_point(p, w);
+            this->statistics(true, true);
+        }
+
+        /*
+         * Bytes taken by the tree, its nodes and all lower levels, not
+         * counting the allocator overhead.
+         */
+        size_t memory_footprint() {
+            size_t bytes = sizeof(*this);
+            std::vector<const void *> layers;
+            this->postorder_dfs(this->tree, [&bytes, &layers](const node *n) {
+                bytes += sizeof(node) + n->value.lower->memory_footprint();
+                if constexpr (D == 2) {
+                    // A counter is shared by the nodes of its subtree, it is counted once.
+                    const void *l = n->value.layers.get();
+                    if (l && std::find(layers.begin(), layers.end(), l) == layers.end()) {
+                        layers.push_back(l);
+                        bytes += n->value.layers->memory_footprint();
+                    }
+                }
+            });
+            return bytes;
+        }
+
+        /*
+         * Count points p with lo[i] <= p[i] <= hi[i] in every dimension.
+         */
+        int_least32_t range_query(const point_type &lo, const point_type &hi) {
+            int_least32_t result = count(lo.data(), hi.data());
+            this->statistics(false, true);
+            return result;
+        }
+
+        /*
+         * Answer range_query for every rectangle, counts[i] for queries[i],
+         * by thread_count threads. The tree must not be modified meanwhile.
+         * Every worker sorts its part of the batch by the first coordinate
+         * interval, so that consecutive queries share cached search paths,
+         * and steals chunks of other parts when it runs out of its own.
+         * Only the number of calls is recorded in statistics, not the visits.
+         */
+        void range_query_batch(const std::vector<rect> &queries, std::vector<int_least32_t> &counts,
+                               const unsigned thread_count = std::thread::hardware_concurrency()) {
+            counts.resize(queries.size());
+            std::vector<size_t> order(queries.size());
+            std::iota(order.begin(), order.end(), 0);
+            work_stealing_for(queries.size(), thread_count, 64, [&](size_t begin, size_t end) {
+                std::sort(order.begin() + begin, order.begin() + end, [&queries](size_t a, size_t b) {
+                    const auto &qa = queries[a];
+                    const auto &qb = queries[b];
+                    return qa.lo[0] < qb.lo[0] || (qa.lo[0] == qb.lo[0] && qa.hi[0] < qb.hi[0]);
+                });
+            }, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    const auto &q = queries[order[i]];
+                    counts[order[i]] = count<false>(q.lo.data(), q.hi.data());
+                }
+            });
+            this->stats.range_count_calls += uint_least32_t(queries.size());
+        }
+
+        /*
+         * Combine weights of points p with lo[i] <= p[i] <= hi[i] in every dimension.
+         */
+        aggregate_type range_aggregate(const point_type &lo, const point_type &hi) {
+            aggregate_type result = aggregate(lo.data(), hi.data());
+            this->statistics(false, true);
+            return result;
+        }
+
+        /*
+         * Call f on every point p with lo[i] <= p[i] <= hi[i] in every
+         * dimension, but on at most limit of them, in no particular order.
+         * Points come from a report_iterator, so the query costs
+         * O(log^D n + k) for k reported points. Returns number of reported
+         * points.
+         */
+        template<typename Lambda>
+        int_least32_t range_report(const point_type &lo, const point_type &hi, Lambda &&f,
+                                   const int_least32_t limit = std::numeric_limits<int_least32_t>::max()) {
+            report_iterator it(*this, lo, hi);
+            int_least32_t reported = 0;
+            const point_type *p;
+            while (reported < limit && (p = it.next())) {
+                f(*p);
+                ++reported;
+            }
+            this->statistics(false, true);
+            return reported;
+        }
+
+        // Same interface as range_tree_2d.
+        template<size_t DD = D, typename = std::enable_if_t<DD == 2>>
+        void insert(const Coord x, const Coord y, const weight_type &w = weight_type()) {
+            insert(point_type{x, y}, w);
+        }
+
+        template<size_t DD = D, typename = std::enable_if_t<DD == 2>>
+        int_least32_t range_query(const Coord x1, const Coord y1, const Coord x2, const Coord y2) {
+            return range_query(point_type{x1, y1}, point_type{x2, y2});
+        }
+
+        template<size_t DD = D, typename = std::enable_if_t<DD == 2>>
+        aggregate_type range_aggregate(const Coord x1, const Coord y1, const Coord x2, const Coord y2) {
+            return range_aggregate(point_type{x1, y1}, point_type{x2, y2});
+        }
+
+        template<typename Lambda, size_t DD = D, typename = std::enable_if_t<DD == 2>>
+        int_least32_t range_report(const Coord x1, const Coord y1, const Coord x2, const Coord y2, Lambda &&f,
+                                   const int_least32_t limit = std::numeric_limits<int_least32_t>::max()) {
+            return range_report(point_type{x1, y1}, point_type{x2, y2}, std::forward<Lambda>(f), limit);
+        }
+
+        /*
+         * Bulk loader of range_tree_2d interface, same as assign. It also
+         * hides bbalpha::build, which would leave lower trees empty.
+         */
+        void build(const std::vector<point_type> &points) {
+            assign(points);
+        }
+
+        void build(std::vector<weighted_point> points) {
+            assign(std::move(points));
+        }
+
+        /*
+         * Replace content of the tree with perfectly balanced tree of points.
+         * Points are sorted once, lower trees are then built from sequences
+         * merged bottom-up, O(n log^(D-1) n) in total.
+         */
+        void assign(const std::vector<point_type> &points) {
+            std::vector<weighted_point> weighted;
+            weighted.reserve(points.size());
+            for (const auto &p : points)
+                weighted.emplace_back(p, weight_type());
+            assign(std::move(weighted));
+        }
+
+        void assign(std::vector<weighted_point> points) {
+            this->statistics(true, false, uint_least32_t(assign_points(std::move(points), this->rebuild_threads)));
+            this->statistics(true, true);
+        }
+
+    protected:
+        /*
+         * After the bbalpha rebuild, lower trees of all nodes within the
+         * rebuilt subtree cover wrong point sets, so they are built again.
+         */
+        node *rebuild(node *n) override {
+            node *root = base::rebuild(n);
+            uint_least64_t visits = 0;
+            build_lower(root, this->rebuild_threads, visits);
+            if constexpr (D == 2)
+                build_layers(root, visits);
+            this->statistics(true, false, uint_least32_t(visits));
+            return root;
+        }
+
+    private:
+        // Index of the first coordinate of this level within points.
+        static constexpr size_t first = Full - D;
+
+        static bool descending(const weighted_point &a, const weighted_point &b) noexcept {
+            return a.first[first] > b.first[first];
+        }
+
+        /*
+         * Insert the point into lower trees of all nodes on the path the
+         * bbalpha insertion takes, then insert node with its own lower tree.
+         */
+        void insert_point(const point_type &p, const weight_type &w) {
+            for (node *n = this->tree; n; n = (n->key() <= p[first]) ? n->right : n->left) {
+                this->statistics(true, false);
+                n->value.lower->insert_point(p, w);
+                if constexpr (D == 2)
+                    n->value.layers.reset();
+            }
+            auto lower = make_lower();
+            lower->insert_point(p, w);
+            base::insert(entry(p, w, std::move(lower)));
+        }
+
+        std::unique_ptr<lower_tree> make_lower() const {
+            auto lower = std::make_unique<lower_tree>(this->alpha, this->stats, compact_block);
+            if constexpr (D > 2)
+                lower->layered = layered;
+            return lower;
+        }
+
+        template<bool Tracked = true>
+        int_least32_t count(const Coord *lo, const Coord *hi) {
+            int_least32_t result = 0;
+            decompose<Tracked>(lo, hi, [&result, lo, hi](const node *n) {
+                result += contains(n, lo, hi);
+            }, [this, &result, lo, hi](const node *n) {
+                if constexpr (D == 2) {
+                    if (n->value.layers) {
+                        result += layers_count<Tracked>(n, lo, hi);
+                        return;
+                    }
+                }
+                result += n->value.lower->template count<Tracked>(lo + 1, hi + 1);
+            }, [this, &result, lo, hi](const node *n) {
+                if constexpr (D == 2) {
+                    if (n->value.layers) {
+                        result += layers_count<Tracked>(n, lo, hi);
+                        return true;
+                    }
+                }
+                return false;
+            });
+            return result;
+        }
+
+        /*
+         * Count points of the subtree of n within the box by its layered
+         * counter, the subtree is a window of positions there.
+         */
+        template<bool Tracked>
+        int_least32_t layers_count(const node *n, const Coord *lo, const Coord *hi) {
+            uint_least32_t visits = 0;
+            const size_t begin = size_t(n->value.layers_offset);
+            int_least32_t result = n->value.layers->range_query(begin, begin + size_t(n->subtree_size), lo[0], lo[1],
+                                                                hi[0], hi[1], visits);
+            if (Tracked)
+                this->statistics(false, false, visits);
+            return result;
+        }
+
+        aggregate_type aggregate(const Coord *lo, const Coord *hi) {
+            aggregate_type result = Aggregate::identity();
+            decompose(lo, hi, [&result, lo, hi](const node *n) {
+                if (contains(n, lo, hi))
+                    result = Aggregate::combine(result, Aggregate::of(n->value.weight()));
+            }, [&result, lo, hi](const node *n) {
+                result = Aggregate::combine(result, n->value.lower->aggregate(lo + 1, hi + 1));
+            });
+            return result;
+        }
+
+        /*
+         * Find the split node of [lo[0], hi[0]] and then go along both paths
+         * from it, calling on_node on nodes with the first coordinate within
+         * the range and on_subtree on canonical subtrees lying inside of it.
+         * Untracked calls do not write anything and may run concurrently.
+         */
+        template<bool Tracked = true, typename NodeLambda, typename SubtreeLambda>
+        void decompose(const Coord *lo, const Coord *hi, NodeLambda &&on_node, SubtreeLambda &&on_subtree) {
+            decompose<Tracked>(lo, hi, on_node, on_subtree, [](const node *) { return false; });
+        }
+
+        /*
+         * Same, but on_whole is called on the split node and on every node
+         * of the paths first, if it returns true it has handled the part of
+         * the node's subtree within the range and the path ends there.
+         */
+        template<bool Tracked = true, typename NodeLambda, typename SubtreeLambda, typename WholeLambda>
+        void decompose(const Coord *lo, const Coord *hi, NodeLambda &&on_node, SubtreeLambda &&on_subtree,
+                       WholeLambda &&on_whole) {
+            node *split = this->tree;
+            while (split) {
+                if (Tracked)
+                    this->statistics(false, false);
+                if (split->key() < lo[0])
+                    split = split->right;
+                else if (hi[0] < split->key())
+                    split = split->left;
+                else
+                    break;
+            }
+            if (!split || on_whole(split))
+                return;
+            on_node(split);
+            for (node *v = split->left; v;) {
+                if (Tracked)
+                    this->statistics(false, false);
+                if (on_whole(v))
+                    break;
+                if (lo[0] <= v->key()) {
+                    on_node(v);
+                    if (v->right)
+                        on_subtree(v->right);
+                    v = v->left;
+                } else {
+                    v = v->right;
+                }
+            }
+            for (node *v = split->right; v;) {
+                if (Tracked)
+                    this->statistics(false, false);
+                if (on_whole(v))
+                    break;
+                if (v->key() <= hi[0]) {
+                    on_node(v);
+                    if (v->left)
+                        on_subtree(v->left);
+                    v = v->right;
+                } else {
+                    v = v->left;
+                }
+            }
+        }
+
+        // The first coordinate of n is already known to lie within the range.
+        static int_least32_t contains(const node *n, const Coord *lo, const Coord *hi) noexcept {
+            for (size_t i = 1; i < D; ++i) {
+                if (n->value.point[first + i] < lo[i] || hi[i] < n->value.point[first + i])
+                    return 0;
+            }
+            return 1;
+        }
+
+        /*
+         * Build the tree of points and all lower trees, return number of
+         * visited nodes without recording them.
+         */
+        uint_least64_t assign_points(std::vector<weighted_point> points, const unsigned thread_count) {
+            // The trees keep larger values in right subtrees, build_t expects descending order.
+            std::sort(points.begin(), points.end(), descending);
+            return assign_sorted(points, thread_count);
+        }
+
+        /*
+         * As assign_points, but points are already sorted by descending
+         * first coordinate.
+         */
+        uint_least64_t assign_sorted(const std::vector<weighted_point> &points, const unsigned thread_count) {
+            this->clear();
+            if (points.empty())
+                return 0;
+            auto size = int_least32_t(points.size());
+            node **array = new node *[size];
+            for (int_least32_t i = 0; i < size; ++i)
+                array[i] = new node(entry(points[i].first, points[i].second, nullptr));
+            this->tree = this->build_t_parallel(array, nullptr, 0, size, thread_count);
+            this->elements_count = size;
+            delete[] array;
+            uint_least64_t visits = uint_least64_t(size);
+            build_lower(this->tree, thread_count, visits);
+            if constexpr (D == 2)
+                build_layers(this->tree, visits);
+            return visits;
+        }
+
+        /*
+         * With layered set, build the layered counter of the points of a
+         * subtree of a 2D level in ascending order of the first coordinate, and point
+         * every node of the subtree to its window there. Visits are added to
+         * visits only.
+         */
+        void build_layers(node *n, uint_least64_t &visits) {
+            if (!layered || !n)
+                return;
+            const auto size = size_t(n->subtree_size);
+            std::vector<Coord> xs(size);
+            std::vector<Coord> ys(size);
+            // inorder_dfs goes from the largest key, so positions are filled from the end.
+            size_t i = size;
+            this->inorder_dfs(n, [&xs, &ys, &i](node *v) {
+                --i;
+                xs[i] = v->value.point[first];
+                ys[i] = v->value.point[first + 1];
+            });
+            auto layers = std::make_shared<const layered_range_counter<Coord>>(std::move(xs), std::move(ys));
+            visits += size * layers->levels();
+            i = size;
+            this->inorder_dfs(n, [&layers, &i](node *v) {
+                --i;
+                v->value.layers = layers;
+                v->value.layers_offset = int_least32_t(i) - ((v->left) ? v->left->subtree_size : 0);
+            });
+        }
+
+        /*
+         * Build lower trees of all nodes in the subtree of n bottom-up and
+         * return all points in the subtree sorted by descending coordinate
+         * of the lower level. As in a merge sort tree, the points of a node
+         * are merged from the sorted points of its children, so lower
+         * trees are built from sorted sequences without sorting, and the whole
+         * subtree takes O(n log n) per lower level. Lower trees of the two
+         * subtrees are independent, so they are built by separate threads
+         * above parallel_rebuild_cutoff. Visits are added to visits only.
+         */
+        std::vector<weighted_point> build_lower(node *n, const unsigned thread_count, uint_least64_t &visits) {
+            if (!n)
+                return {};
+            std::vector<weighted_point> right_points;
+            std::vector<weighted_point> left_points;
+            if (thread_count > 1 && n->subtree_size >= base::parallel_rebuild_cutoff) {
+                uint_least64_t right_visits = 0;
+                std::thread right([&]() {
+                    right_points = build_lower(n->right, thread_count / 2, right_visits);
+                });
+                left_points = build_lower(n->left, thread_count - thread_count / 2, visits);
+                right.join();
+                visits += right_visits;
+            } else {
+                right_points = build_lower(n->right, 1, visits);
+                left_points = build_lower(n->left, 1, visits);
+            }
+            std::vector<weighted_point> points = merge_subtree(right_points, left_points,
+                                                               weighted_point(n->value.point, n->value.weight()),
+                                                               lower_tree::descending);
+            n->value.lower = make_lower();
+            visits += n->value.lower->assign_sorted(points, thread_count);
+            return points;
+        }
+    };
+
+    /*
+     * Lazy enumeration of points within a box. The O(log n) canonical nodes
+     * and subtrees of the first coordinate are found at once, the lower tree
+     * of a subtree is searched by an iterator of the lower level only when
+     * the points before it have been taken. The tree must not be modified
+     * while the iterator is in use.
+     */
+    template<size_t D, typename Coord, typename Aggregate, size_t Full>
+    class range_tree<D, Coord, Aggregate, Full>::report_iterator {
+    public:
+        using tree_type = range_tree<D, Coord, Aggregate, Full>;
+
+        // Box of the coordinates of the tree's level, D of each.
+        report_iterator(tree_type &t, const Coord *lo, const Coord *hi) {
+            std::copy(lo, lo + D, lo_.begin());
+            std::copy(hi, hi + D, hi_.begin());
+            t.decompose(lo_.data(), hi_.data(), [this](node *n) {
+                pieces_.emplace_back(n, false);
+            }, [this](node *n) {
+                pieces_.emplace_back(n, true);
+            });
+            std::reverse(pieces_.begin(), pieces_.end());
+        }
+
+        report_iterator(tree_type &t, const point_type &lo, const point_type &hi) :
+                report_iterator(t, lo.data(), hi.data()) {}
+
+        /*
+         * Return next point within the box or nullptr when the box is exhausted.
+         */
+        const point_type *next() {
+            while (true) {
+                if (lower_) {
+                    if (const point_type *p = lower_->next())
+                        return p;
+                    lower_.reset();
+                }
+                if (pieces_.empty())
+                    return nullptr;
+                const std::pair<node *, bool> piece = pieces_.back();
+                pieces_.pop_back();
+                if (piece.second)
+                    lower_.emplace(*piece.first->value.lower, lo_.data() + 1, hi_.data() + 1);
+                else if (contains(piece.first, lo_.data(), hi_.data()))
+                    return &piece.first->value.point;
+            }
+        }
+
+    private:
+        std::array<Coord, D> lo_;
+        std::array<Coord, D> hi_;
+        // Canonical nodes, and subtrees whose lower trees are to be searched, the next one last.
+        std::vector<std::pair<node *, bool>> pieces_;
+        std::optional<typename lower_tree::report_iterator> lower_;
+    };
+
+    /*
+     * The last level of range tree -- bbalpha tree over the last coordinate
+     * counting with subtree sizes and combining with subtree aggregates.
+     */
+    template<typename Coord, typename Aggregate, size_t Full>
+    class range_tree<1, Coord, Aggregate, Full> :
+            public bbalpha<range_tree_leaf<Coord, Aggregate, Full>, weighted_aggregate<Aggregate>> {
+        template<size_t, typename, typename, size_t> friend class range_tree;
+
+    public:
+        using base = bbalpha<range_tree_leaf<Coord, Aggregate, Full>, weighted_aggregate<Aggregate>>;
+        using node = typename base::node;
+        using leaf = range_tree_leaf<Coord, Aggregate, Full>;
+        using point_type = std::array<Coord, Full>;
+        using weight_type = typename Aggregate::weight_type;
+        using weighted_point = std::pair<point_type, weight_type>;
+        using aggregate_type = typename Aggregate::type;
+
+        const int_least32_t compact_block;
+
+        range_tree(double a, statistics_ &s, const int_least32_t compact = 0) : base(a, s), compact_block(compact) {
+            if (compact_block > 0) {
+                if (!std::is_same<Aggregate, no_aggregate>::value)
+                    throw std::invalid_argument("Compact range tree does not support aggregates.");
+                keys_ = std::make_unique<blocked_keys<leaf>>(compact_block);
+            }
+        }
+
+        class report_iterator;
+
+        void insert(const point_type &p, const weight_type &w = weight_type()) {
+            insert_point(p, w);
+            this->statistics(true, true);
+        }
+
+        size_t memory_footprint() const noexcept {
+            return sizeof(*this) + ((keys_) ? keys_->memory_footprint() : size_t(this->elements_count) * sizeof(node));
+        }
+
+        int_least32_t range_query(const point_type &lo, const point_type &hi) {
+            int_least32_t result = count(lo.data(), hi.data());
+            this->statistics(false, true);
+            return result;
+        }
+
+        aggregate_type range_aggregate(const point_type &lo, const point_type &hi) {
+            aggregate_type result = aggregate(lo.data(), hi.data());
+            this->statistics(false, true);
+            return result;
+        }
+
+        // Same as range_report of range_tree, it hides the one of bbalpha.
+        template<typename Lambda>
+        int_least32_t range_report(const point_type &lo, const point_type &hi, Lambda &&f,
+                                   const int_least32_t limit = std::numeric_limits<int_least32_t>::max()) {
+            report_iterator it(*this, lo.data(), hi.data());
+            int_least32_t reported = 0;
+            const point_type *p;
+            while (reported < limit && (p = it.next())) {
+                f(*p);
+                ++reported;
+            }
+            this->statistics(false, true);
+            return reported;
+        }
+
+        void assign(std::vector<weighted_point> points) {
+            this->statistics(true, false, uint_least32_t(assign_points(std::move(points), this->rebuild_threads)));
+            this->statistics(true, true);
+        }
+
+    private:
+        static bool descending(const weighted_point &a, const weighted_point &b) noexcept {
+            return a.first[Full - 1] > b.first[Full - 1];
+        }
+
+        uint_least64_t assign_points(std::vector<weighted_point> points, const unsigned thread_count) {
+            std::sort(points.begin(), points.end(), descending);
+            return assign_sorted(points, thread_count);
+        }
+
+        // Points are already sorted by descending last coordinate.
+        uint_least64_t assign_sorted(const std::vector<weighted_point> &points, const unsigned thread_count) {
+            this->clear();
+            if (keys_) {
+                std::vector<leaf> keys;
+                keys.reserve(points.size());
+                for (auto it = points.rbegin(); it != points.rend(); ++it)
+                    keys.emplace_back(it->first, it->second);
+                keys_->assign(keys.begin(), keys.end());
+                this->elements_count = int_least32_t(points.size());
+                return uint_least64_t(points.size());
+            }
+            if (points.empty())
+                return 0;
+            auto size = int_least32_t(points.size());
+            node **array = new node *[size];
+            for (int_least32_t i = 0; i < size; ++i)
+                array[i] = new node(leaf(points[i].first, points[i].second));
+            this->tree = this->build_t_parallel(array, nullptr, 0, size, thread_count);
+            this->elements_count = size;
+            delete[] array;
+            return uint_least64_t(size);
+        }
+
+        // Compact storage, null unless compact_block > 0.
+        std::unique_ptr<blocked_keys<leaf>> keys_;
+
+        void insert_point(const point_type &p, const weight_type &w) {
+            if (keys_) {
+                this->statistics(true, false, keys_->search_depth());
+                keys_->insert(leaf(p, w));
+                ++this->elements_count;
+                return;
+            }
+            base::insert(leaf(p, w));
+        }
+
+        template<bool Tracked = true>
+        int_least32_t count(const Coord *lo, const Coord *hi) {
+            if (keys_) {
+                if (hi[0] < lo[0])
+                    return 0;
+                if (Tracked)
+                    this->statistics(false, false, 2 * keys_->search_depth());
+                return keys_->rank(hi[0], true) - keys_->rank(lo[0], false);
+            }
+            return (hi[0] < lo[0]) ? 0 :
+                   this->template rank<Tracked>(hi[0], true) - this->template rank<Tracked>(lo[0], false);
+        }
+
+        aggregate_type aggregate(const Coord *lo, const Coord *hi) {
+            return this->aggregate_between(lo[0], hi[0]);
+        }
+    };
+
+    /*
+     * Points of the last level within [lo[0], hi[0]] in ascending order, by
+     * bbalpha::range_iterator or by ranks in compact storage.
+     */
+    template<typename Coord, typename Aggregate, size_t Full>
+    class range_tree<1, Coord, Aggregate, Full>::report_iterator {
+    public:
+        using tree_type = range_tree<1, Coord, Aggregate, Full>;
+
+        report_iterator(tree_type &t, const Coord *lo, const Coord *hi) : tree_(t), it_(t, lo[0], hi[0]) {
+            if (t.keys_ && !(hi[0] < lo[0])) {
+                t.statistics(false, false, 2 * t.keys_->search_depth());
+                i_ = t.keys_->rank(lo[0], false);
+                end_ = t.keys_->rank(hi[0], true);
+            }
+        }
+
+        /*
+         * Return next point within the range or nullptr when the range is exhausted.
+         */
+        const point_type *next() {
+            if (tree_.keys_)
+                return (i_ < end_) ? &tree_.keys_->at(i_++).point : nullptr;
+            const node *n = it_.next();
+            return (n) ? &n->value.point : nullptr;
+        }
+
+    private:
+        tree_type &tree_;
+        typename base::range_iterator it_;
+        int_least32_t i_ = 0;
+        int_least32_t end_ = 0;
+    };
+
+}
+
+#endif //DATA_STRUCTURES_KD_RANGE_TREE_H
@@ -0,0 +1,114 @@
+#ifndef DATA_STRUCTURES_LAYERED_COUNT_H
+#define DATA_STRUCTURES_LAYERED_COUNT_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <algorithm>
+
+namespace rt {
+
+    /*
+     * Lowest bridged level of the layered layout shared by
+     * layered_range_counter and mapped_range_tree. Points are sorted by x,
+     * the x-node of level k covering points [i 2^k, (i + 1) 2^k) is
+     * implicit, its y coordinates would be the sorted run at the same
+     * positions within a level k array. Only level 0, y in the order of x,
+     * and the top level, all y sorted, are stored. Every level k above
+     * layered_min_level stores bridges instead -- one bit per position, set
+     * if the y there comes from the left child -- so the rank of a y within
+     * a node gives its rank within both children (fractional cascading).
+     * Partly covered nodes of layered_min_level are scanned in level 0.
+     */
+    constexpr uint32_t layered_min_level = 4;
+
+    // 64 bridge bits and the number of set bits of the level before them.
+    struct layered_bridge_word {
+        uint64_t bits;
+        uint64_t ones;
+    };
+
+    // Words of bridges of a level of n positions, rank of n included.
+    inline size_t layered_bridge_words(const size_t n) noexcept {
+        return n / 64 + 1;
+    }
+
+    // Set the counts of ones of the words of bridges of n positions.
+    inline void layered_bridge_ranks(layered_bridge_word *words, const size_t n) noexcept {
+        uint64_t ones = 0;
+        for (size_t w = 0; w < layered_bridge_words(n); ++w) {
+            words[w].ones = ones;
+            ones += uint64_t(__builtin_popcountll(words[w].bits));
+        }
+    }
+
+    // Number of set bridges at positions [0, i) of a level.
+    inline size_t layered_bridge_rank(const layered_bridge_word *words, const size_t i) noexcept {
+        const layered_bridge_word &w = words[i / 64];
+        const uint64_t below = (uint64_t(1) << (i % 64)) - 1;
+        return size_t(w.ones) + size_t(__builtin_popcountll(w.bits & below));
+    }
+
+    /*
+     * Count points of x-node [s, s + 2^k) at positions [l, r) of level 0
+     * with y1 <= y <= y2, where a and b are the positions of the lower bound
+     * of y1 and the upper bound of y2 within the node's run of level k.
+     */
+    template<typename Coord, typename Bridges>
+    int_least32_t layered_descend(const size_t n, const size_t l, const size_t r, const uint32_t k, const size_t s,
+                                  const size_t a, const size_t b, const Coord *ys, const Coord y1, const Coord y2,
+                                  Bridges &bridges, uint_least32_t &visits) {
+        ++visits;
+        const size_t e = std::min(s + (size_t(1) << k), n);
+        if (r <= s || e <= l || a == b)
+            return 0;
+        if (l <= s && e <= r)
+            return int_least32_t(b - a);
+        if (k == layered_min_level) {
+            int_least32_t result = 0;
+            for (size_t i = std::max(s, l); i < std::min(e, r); ++i, ++visits)
+                result += (!(ys[i] < y1) && !(y2 < ys[i])) ? 1 : 0;
+            return result;
+        }
+        // Positions before a (or b) within the run, split by the child they come from.
+        const layered_bridge_word *words = bridges(k);
+        const size_t m = std::min(s + (size_t(1) << (k - 1)), n);
+        const size_t left = layered_bridge_rank(words, s);
+        const size_t la = layered_bridge_rank(words, a) - left, lb = layered_bridge_rank(words, b) - left;
+        int_least32_t result = layered_descend(n, l, r, k - 1, s, s + la, s + lb, ys, y1, y2, bridges, visits);
+        if (m < e)
+            result += layered_descend(n, l, r, k - 1, m, m + (a - s - la), m + (b - s - lb), ys, y1, y2, bridges,
+                                      visits);
+        return result;
+    }
+
+    /*
+     * Count points at positions [l, r) with y1 <= y <= y2 in the layered
+     * layout of n points and levels levels. ys are the y coordinates of
+     * level 0, top_bound(v, upper) returns the lower (or upper) bound of v
+     * in the top level and bridges(k) the bridge words of level k. After
+     * the two searches at the top, the x-nodes covering [l, r) are found
+     * from the root down following bridges, O(1) per node, so a query
+     * costs O(log n). Adds number of visited nodes and scanned points to
+     * visits.
+     */
+    template<typename Coord, typename TopBound, typename Bridges>
+    int_least32_t layered_count(const size_t n, const size_t l, const size_t r, const uint32_t levels, const Coord *ys,
+                                const Coord y1, const Coord y2, TopBound &&top_bound, Bridges &&bridges,
+                                uint_least32_t &visits) {
+        if (l >= r)
+            return 0;
+        const uint32_t top = levels - 1;
+        if (top < layered_min_level) {
+            // Too few points for bridges, scanned.
+            int_least32_t result = 0;
+            for (size_t i = l; i < r; ++i, ++visits)
+                result += (!(ys[i] < y1) && !(y2 < ys[i])) ? 1 : 0;
+            return result;
+        }
+        const size_t a = top_bound(y1, false), b = top_bound(y2, true);
+        return layered_descend(n, l, r, top, 0, a, b, ys, y1, y2, bridges, visits);
+    }
+
+}
+
+#endif //DATA_STRUCTURES_LAYERED_COUNT_H
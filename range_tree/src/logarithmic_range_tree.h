@@ -0,0 +1,358 @@
+#ifndef DATA_STRUCTURES_LOGARITHMIC_RANGE_TREE_H
+#define DATA_STRUCTURES_LOGARITHMIC_RANGE_TREE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <array>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "bbalpha_tree.h"
+#include "layered_count.h"
+
+namespace rt {
+
+    /*
+     * Static 2D range counter of flat arrays in the layered layout (see
+     * layered_count), points are sorted by x, then y. Takes three
+     * coordinates and O(log n) bits per point, a query O(log n). Built by
+     * the resumable builder below.
+     */
+    template<typename Coord = int_least32_t>
+    class layered_range_counter {
+    public:
+        using point_type = std::array<Coord, 2>;
+
+        static constexpr uint32_t min_level = layered_min_level;
+
+        class builder;
+
+        layered_range_counter() = default;
+
+        // Build the counter at once.
+        explicit layered_range_counter(const std::vector<point_type> &points) {
+            layered_range_counter sorted, empty;
+            sorted.xs_.resize(points.size());
+            sorted.ys_.resize(points.size());
+            std::vector<point_type> order(points);
+            std::sort(order.begin(), order.end());
+            for (size_t i = 0; i < order.size(); ++i) {
+                sorted.xs_[i] = order[i][0];
+                sorted.ys_[i] = order[i][1];
+            }
+            builder b(sorted, empty);
+            b.step(b.total_work());
+            *this = b.result();
+        }
+
+        /*
+         * Build the counter of points already sorted by x, xs[i] and ys[i]
+         * of each, in their order, so that points with equal x keep it.
+         */
+        layered_range_counter(std::vector<Coord> xs, std::vector<Coord> ys) {
+            layered_range_counter sorted, empty;
+            sorted.xs_ = std::move(xs);
+            sorted.ys_ = std::move(ys);
+            builder b(sorted, empty);
+            b.step(b.total_work());
+            *this = b.result();
+        }
+
+        size_t size() const noexcept { return xs_.size(); }
+
+        // Number of levels, the top one is a single node.
+        size_t levels() const noexcept { return levels_; }
+
+        point_type point(const size_t i) const noexcept { return {xs_[i], ys_[i]}; }
+
+        // Bytes taken by the counter, not counting the allocator overhead.
+        size_t memory_footprint() const noexcept {
+            size_t bytes = sizeof(*this) + (xs_.size() + ys_.size() + top_.size()) * sizeof(Coord);
+            for (const auto &level : bridges_)
+                bytes += sizeof(level) + level.size() * sizeof(layered_bridge_word);
+            return bytes;
+        }
+
+        /*
+         * Return number of points with x1 <= x <= x2 and y1 <= y <= y2, add
+         * number of visited nodes and scanned points to visits.
+         */
+        int_least32_t range_query(const Coord x1, const Coord y1, const Coord x2, const Coord y2,
+                                  uint_least32_t &visits) const {
+            return range_query(0, size(), x1, y1, x2, y2, visits);
+        }
+
+        // Same, but only points at positions [begin, end) are counted.
+        int_least32_t range_query(const size_t begin, const size_t end, const Coord x1, const Coord y1,
+                                  const Coord x2, const Coord y2, uint_least32_t &visits) const {
+            if (end <= begin || x2 < x1 || y2 < y1)
+                return 0;
+            const size_t l = size_t(std::lower_bound(xs_.begin() + begin, xs_.begin() + end, x1) - xs_.begin());
+            const size_t r = size_t(std::upper_bound(xs_.begin() + begin, xs_.begin() + end, x2) - xs_.begin());
+            return layered_count(xs_.size(), l, r, levels_, ys_.data(), y1, y2,
+                                 [this](const Coord v, bool upper) {
+                return size_t(((upper) ? std::upper_bound(top_.begin(), top_.end(), v)
+                                       : std::lower_bound(top_.begin(), top_.end(), v)) - top_.begin());
+            }, [this](uint32_t k) { return bridges_[k - min_level - 1].data(); }, visits);
+        }
+
+    private:
+        std::vector<Coord> xs_;
+        // Level 0.
+        std::vector<Coord> ys_;
+        // Top level, if above min_level.
+        std::vector<Coord> top_;
+        // Bridges of levels above min_level, from min_level + 1 on.
+        std::vector<std::vector<layered_bridge_word>> bridges_;
+        uint32_t levels_ = 0;
+    };
+
+    /*
+     * Builds the counter of the points of two others, in steps of bounded
+     * work. One unit of work writes one coordinate -- merging the sorted
+     * points of the sources, then every level from runs of the previous one,
+     * setting its bridges. Sources must not change until the build is done.
+     */
+    template<typename Coord>
+    class layered_range_counter<Coord>::builder {
+    public:
+        using counter = layered_range_counter<Coord>;
+
+        builder(const counter &a, const counter &b) : a_(a), b_(b) {
+            const size_t n = a.size() + b.size();
+            uint32_t levels = 1;
+            while ((size_t(1) << (levels - 1)) < n)
+                ++levels;
+            result_.levels_ = levels;
+            result_.xs_.resize(n);
+            result_.ys_.resize(n);
+            if (levels > min_level + 1)
+                result_.bridges_.resize(levels - min_level - 1,
+                                        std::vector<layered_bridge_word>(layered_bridge_words(n), {0, 0}));
+            previous_ = &result_.ys_;
+        }
+
+        size_t total_work() const noexcept {
+            return result_.size() * result_.levels_;
+        }
+
+        bool done() const noexcept { return level_ >= result_.levels_; }
+
+        /*
+         * Do at most budget units of work, return number of units done.
+         */
+        size_t step(const size_t budget) {
+            const size_t n = result_.size();
+            size_t work = 0;
+            while (work < budget && !done()) {
+                if (level_ == 0) {
+                    for (; work < budget && out_ < n; ++work, ++out_) {
+                        const bool from_a = j_ >= b_.size() || (i_ < a_.size() && !(b_.point(j_) < a_.point(i_)));
+                        const point_type p = (from_a) ? a_.point(i_++) : b_.point(j_++);
+                        result_.xs_[out_] = p[0];
+                        result_.ys_[out_] = p[1];
+                    }
+                } else {
+                    // Runs of level k are merged pairs of runs of level k - 1.
+                    const std::vector<Coord> &previous = *previous_;
+                    std::vector<Coord> &current = (level_ + 1 < result_.levels_) ? scratch_[level_ % 2] : result_.top_;
+                    if (current.size() != n)
+                        current.resize(n);
+                    layered_bridge_word *bridges = (level_ > min_level) ? result_.bridges_[level_ - min_level - 1].data()
+                                                                        : nullptr;
+                    const size_t half = size_t(1) << (level_ - 1);
+                    while (work < budget && run_ < n) {
+                        const size_t m = std::min(run_ + half, n), e = std::min(run_ + 2 * half, n);
+                        for (; work < budget && out_ < e; ++work, ++out_) {
+                            const bool from_left = j_ >= e - m ||
+                                                   (run_ + i_ < m && !(previous[m + j_] < previous[run_ + i_]));
+                            current[out_] = (from_left) ? previous[run_ + i_++] : previous[m + j_++];
+                            if (from_left && bridges)
+                                bridges[out_ / 64].bits |= uint64_t(1) << (out_ % 64);
+                        }
+                        if (out_ == e) {
+                            run_ = e;
+                            i_ = j_ = 0;
+                        }
+                    }
+                    if (run_ < n)
+                        break;
+                    if (bridges)
+                        layered_bridge_ranks(bridges, n);
+                    previous_ = &current;
+                }
+                if (out_ < n)
+                    break;
+                ++level_;
+                run_ = i_ = j_ = out_ = 0;
+            }
+            if (done()) {
+                scratch_[0] = std::vector<Coord>();
+                scratch_[1] = std::vector<Coord>();
+            }
+            return work;
+        }
+
+        // The built counter, once done.
+        counter result() { return std::move(result_); }
+
+    private:
+        const counter &a_;
+        const counter &b_;
+        counter result_;
+        // Levels below the top alternate in two scratch arrays.
+        std::vector<Coord> scratch_[2];
+        const std::vector<Coord> *previous_;
+        size_t level_ = 0;
+        size_t run_ = 0;
+        size_t i_ = 0;
+        size_t j_ = 0;
+        size_t out_ = 0;
+    };
+
+    /*
+     * Dynamic 2D range counting by the logarithmic method of Bentley and
+     * Saxe. New points go to a buffer of buffer_size points, scanned by
+     * queries. A full buffer becomes a static counter of level 0, and two
+     * counters of level i are merged into one of level i + 1, so there are
+     * O(log n) counters of doubling sizes and a query sums all of them.
+     *
+     * By default the merges are done at once, an insert costs
+     * O(log^2 n) amortized but the one completing level i takes
+     * O(2^i log n). The deamortized mode keeps the two counters of a level
+     * queryable while they are merged, and advances every merge by a fixed
+     * budget on each insert. The budget lets the merge finish before the
+     * level gets another counter, so an insert does O(log^2 n) work in the
+     * worst case. Inserts count units of work as visits, queries the visited
+     * nodes.
+     */
+    template<typename Coord = int_least32_t>
+    class logarithmic_range_tree {
+    public:
+        using counter = layered_range_counter<Coord>;
+        using point_type = std::array<Coord, 2>;
+
+        statistics_ &stats;
+        const bool deamortized;
+        const size_t buffer_size;
+
+        explicit logarithmic_range_tree(statistics_ &s, const bool deamortize = false, const size_t buffer = 64) :
+                stats(s), deamortized(deamortize), buffer_size(std::max<size_t>(buffer, 1)) {
+            buffer_.reserve(buffer_size);
+        }
+
+        size_t size() const noexcept { return size_; }
+
+        // Number of static counters, including the ones being merged.
+        size_t counters() const noexcept {
+            size_t count = 0;
+            for (const auto &l : levels_)
+                count += l.full.size();
+            return count;
+        }
+
+        void insert(const point_type &p) {
+            buffer_.push_back(p);
+            ++size_;
+            stats.record(true, false);
+            if (buffer_.size() == buffer_size)
+                flush_buffer();
+            if (deamortized) {
+                // Levels may grow while merges finish, the new ones are stepped too.
+                for (size_t i = 0; i < levels_.size(); ++i) {
+                    level &l = levels_[i];
+                    if (l.merging) {
+                        stats.record(true, false, uint_least32_t(l.merging->step(l.budget)));
+                        if (l.merging->done())
+                            finish_merge(i);
+                    }
+                }
+            }
+            stats.record(true, true);
+        }
+
+        void insert(const Coord x, const Coord y) {
+            insert(point_type{x, y});
+        }
+
+        /*
+         * Return number of points with x1 <= x <= x2 and y1 <= y <= y2.
+         */
+        int_least32_t range_query(const Coord x1, const Coord y1, const Coord x2, const Coord y2) {
+            int_least32_t result = 0;
+            uint_least32_t visits = uint_least32_t(buffer_.size());
+            for (const point_type &p : buffer_)
+                result += (!(p[0] < x1) && !(x2 < p[0]) && !(p[1] < y1) && !(y2 < p[1])) ? 1 : 0;
+            for (const auto &l : levels_) {
+                for (const counter &c : l.full)
+                    result += c.range_query(x1, y1, x2, y2, visits);
+            }
+            stats.record(false, false, visits);
+            stats.record(false, true);
+            return result;
+        }
+
+        int_least32_t range_query(const point_type &lo, const point_type &hi) {
+            return range_query(lo[0], lo[1], hi[0], hi[1]);
+        }
+
+    private:
+        struct level {
+            // Counters of buffer_size 2^i points. While merging, the first
+            // two are its sources.
+            std::deque<counter> full;
+            std::unique_ptr<typename counter::builder> merging;
+            size_t budget = 0;
+        };
+
+        std::vector<point_type> buffer_;
+        // Builders refer to counters of levels, a deque keeps them in place.
+        std::deque<level> levels_;
+        size_t size_ = 0;
+
+        void flush_buffer() {
+            counter c(buffer_);
+            buffer_.clear();
+            stats.record(true, false, uint_least32_t(c.size() * c.levels()));
+            add(0, std::move(c));
+        }
+
+        void add(const size_t i, counter c) {
+            if (levels_.size() == i)
+                levels_.emplace_back();
+            level &l = levels_[i];
+            // Only if a merge ran out of its budget, never with the default one.
+            if (l.merging && l.full.size() == 2)
+                finish(i);
+            l.full.push_back(std::move(c));
+            if (l.full.size() < 2 || l.merging)
+                return;
+            l.merging.reset(new typename counter::builder(l.full[0], l.full[1]));
+            if (!deamortized) {
+                finish(i);
+                return;
+            }
+            // Twice the rate needed to finish before the next counter of this level comes.
+            const size_t interval = buffer_size << i;
+            l.budget = 2 * ((l.merging->total_work() + interval - 1) / interval);
+        }
+
+        void finish(const size_t i) {
+            level &l = levels_[i];
+            stats.record(true, false, uint_least32_t(l.merging->step(l.merging->total_work())));
+            finish_merge(i);
+        }
+
+        void finish_merge(const size_t i) {
+            counter merged = levels_[i].merging->result();
+            levels_[i].merging.reset();
+            levels_[i].full.pop_front();
+            levels_[i].full.pop_front();
+            add(i + 1, std::move(merged));
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_LOGARITHMIC_RANGE_TREE_H
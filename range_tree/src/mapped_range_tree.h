@@ -0,0 +1,433 @@
+#ifndef DATA_STRUCTURES_MAPPED_RANGE_TREE_H
+#define DATA_STRUCTURES_MAPPED_RANGE_TREE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bbalpha_tree.h"
+#include "kd_range_tree.h"
+#include "layered_count.h"
+
+namespace rt {
+
+    /*
+     * Frozen 2D range tree stored in a flat file and opened with mmap, for
+     * point sets larger than RAM. Points are sorted by x, then y, in the
+     * layered layout of layered_range_counter (see layered_count) -- arrays
+     * of x, y of level 0 and y of the top level, then the bridge words of
+     * every bridged level. Every page_size-th coordinate of each array is
+     * copied to its fence array. Fences of all arrays are packed right
+     * after the header, so a binary search reads one cold page of the
+     * array itself, and a query pages in O(log n) blocks of bridges.
+     *
+     * Opening maps the file and checks its header only. Inserted points are
+     * appended to a log next to the file and kept in a small dynamic
+     * range_tree. Snapshot streams the merge of the file with the sorted
+     * pending points into a new file, which replaces the old one by rename,
+     * and starts a new log. The file is in the byte order of the machine
+     * that wrote it.
+     */
+    template<typename Coord = int_least32_t>
+    class mapped_range_tree {
+        static_assert(std::is_trivially_copyable<Coord>::value, "Coordinates are stored as raw bytes.");
+
+    public:
+        using point_type = std::array<Coord, 2>;
+
+        static constexpr size_t page_size = 4096;
+        static constexpr uint32_t min_level = layered_min_level;
+
+        /*
+         * Write frozen tree of points to path, with no pending log. The log
+         * of an earlier tree at the same path is removed.
+         */
+        static void write(const std::string &path, std::vector<point_type> points) {
+            file_header old = {};
+            {
+                std::ifstream ifs(path, std::ios::binary);
+                if (!ifs.read(reinterpret_cast<char *>(&old), sizeof(old)) ||
+                    std::memcmp(old.magic, magic, sizeof(magic)) != 0)
+                    old.log_generation = 0;
+                else
+                    std::remove(log_path(path, old.log_generation).c_str());
+            }
+            std::remove(log_path(path, old.log_generation + 1).c_str());
+            std::sort(points.begin(), points.end());
+            size_t i = 0;
+            write(path, points.size(), [&points, &i]() { return points[i++]; }, old.log_generation + 1);
+        }
+
+        explicit mapped_range_tree(std::string path, const double alpha = 0.7) :
+                path_(std::move(path)), pending_(alpha, stats_) {
+            map();
+            replay_log();
+        }
+
+        mapped_range_tree(const mapped_range_tree &other) = delete;
+        mapped_range_tree &operator=(const mapped_range_tree &other) = delete;
+
+        ~mapped_range_tree() {
+            unmap();
+        }
+
+        // Number of points, frozen and pending.
+        size_t size() const noexcept { return size_t(header_.size) + pending_points_.size(); }
+
+        // Number of points in the log, not merged into the file yet.
+        size_t pending() const noexcept { return pending_points_.size(); }
+
+        // Bytes of the mapped file, only the touched pages are resident.
+        size_t mapped_bytes() const noexcept { return map_bytes_; }
+
+        void insert(const Coord x, const Coord y) {
+            const point_type p{x, y};
+            log_.write(reinterpret_cast<const char *>(p.data()), sizeof(point_type));
+            log_.flush();
+            if (!log_)
+                throw std::runtime_error("Cannot append to " + log_path());
+            pending_.insert(p);
+            pending_points_.push_back(p);
+        }
+
+        /*
+         * Return number of points with x1 <= x <= x2 and y1 <= y <= y2.
+         */
+        int_least32_t range_query(const Coord x1, const Coord y1, const Coord x2, const Coord y2) {
+            int_least32_t result = (pending_points_.empty()) ? 0 : pending_.range_query(x1, y1, x2, y2);
+            if (x2 < x1 || y2 < y1)
+                return result;
+            const size_t n = size_t(header_.size);
+            const size_t l = bound(xs_, 0, 0, n, x1, false);
+            const size_t r = bound(xs_, 0, 0, n, x2, true);
+            uint_least32_t visits = 0;
+            return result + layered_count(n, l, r, header_.levels, ys_, y1, y2,
+                                          [this, n](const Coord v, bool upper) {
+                return bound(top_, 2, 0, n, v, upper);
+            }, [this](uint32_t k) { return level_bridges(k); }, visits);
+        }
+
+        /*
+         * Merge the pending points into a new frozen file. The points of the
+         * file are read in order from the mapping and merged with the sorted
+         * pending ones on the fly, only the pending points are held in
+         * memory. The old file is replaced by rename only after the new one
+         * is complete, then the old log is removed, so a crash at any point
+         * leaves either the old file with its log or the new one.
+         */
+        void snapshot() {
+            if (pending_points_.empty())
+                return;
+            const size_t n = size_t(header_.size);
+            std::vector<point_type> pending(pending_points_);
+            std::sort(pending.begin(), pending.end());
+            size_t i = 0, j = 0;
+            auto next = [this, n, &pending, &i, &j]() {
+                if (j < pending.size() && (i == n || pending[j] < point_type{xs_[i], ys_[i]}))
+                    return pending[j++];
+                const point_type p{xs_[i], ys_[i]};
+                ++i;
+                return p;
+            };
+            const std::string old_log = log_path();
+            const std::string temporary = path_ + ".tmp";
+            // A stale log of the next generation would be taken as pending points.
+            std::remove(log_path(path_, header_.log_generation + 1).c_str());
+            write(temporary, n + pending.size(), next, header_.log_generation + 1);
+            if (std::rename(temporary.c_str(), path_.c_str()) != 0)
+                throw std::system_error(errno, std::generic_category(), path_);
+            log_.close();
+            unmap();
+            map();
+            std::remove(old_log.c_str());
+            replay_log();
+        }
+
+    private:
+        struct file_header {
+            char magic[8];
+            uint64_t size;
+            uint32_t coord_bytes;
+            uint32_t levels;          // Top level + 1, the top node covers all points.
+            uint64_t log_generation;  // Suffix of the log belonging to this file.
+            uint64_t fences_offset;
+            uint64_t xs_offset;
+            uint64_t ys_offset;       // Level 0.
+            uint64_t top_offset;      // Top level, all y sorted.
+            uint64_t bridges_offset;  // Levels min_level + 1 and up.
+        };
+
+        static constexpr char magic[8] = {'R', 'T', 'M', 'A', 'P', '0', '0', '2'};
+        static constexpr size_t fence_stride = page_size / sizeof(Coord);
+
+        std::string path_;
+        file_header header_ = {};
+        void *map_ = nullptr;
+        size_t map_bytes_ = 0;
+        const Coord *fences_ = nullptr;
+        const Coord *xs_ = nullptr;
+        const Coord *ys_ = nullptr;
+        const Coord *top_ = nullptr;
+        const layered_bridge_word *bridges_ = nullptr;
+        statistics_ stats_;
+        range_tree<2, Coord> pending_;
+        std::vector<point_type> pending_points_;
+        std::ofstream log_;
+
+        static size_t aligned(const size_t bytes) noexcept {
+            return (bytes + page_size - 1) / page_size * page_size;
+        }
+
+        static size_t fence_count(const size_t n) noexcept {
+            return (n + fence_stride - 1) / fence_stride;
+        }
+
+        static uint32_t bridged_levels(const uint32_t levels) noexcept {
+            return (levels > min_level + 1) ? levels - min_level - 1 : 0;
+        }
+
+        // Bytes of bridges of one level, a multiple of page_size.
+        static size_t bridge_stride(const size_t n) noexcept {
+            return aligned(layered_bridge_words(n) * sizeof(layered_bridge_word));
+        }
+
+        static std::string log_path(const std::string &path, const uint64_t generation) {
+            return path + ".log" + std::to_string(generation);
+        }
+
+        std::string log_path() const {
+            return log_path(path_, header_.log_generation);
+        }
+
+        const layered_bridge_word *level_bridges(const uint32_t k) const noexcept {
+            const size_t words = bridge_stride(size_t(header_.size)) / sizeof(layered_bridge_word);
+            return bridges_ + (k - min_level - 1) * words;
+        }
+
+        /*
+         * Lower (or upper) bound of v within a[s, e), a run sorted in the
+         * array-th array. Fences within the run narrow the search to one
+         * page first.
+         */
+        size_t bound(const Coord *a, const size_t array, size_t s, size_t e, const Coord v, const bool upper) const {
+            const size_t fs = (s + fence_stride - 1) / fence_stride;
+            const size_t fe = (e + fence_stride - 1) / fence_stride;
+            if (fs < fe) {
+                const Coord *fences = fences_ + array * fence_count(size_t(header_.size));
+                const size_t f = size_t(((upper) ? std::upper_bound(fences + fs, fences + fe, v)
+                                                 : std::lower_bound(fences + fs, fences + fe, v)) - fences);
+                if (f > fs)
+                    s = (f - 1) * fence_stride;
+                if (f < fe)
+                    e = f * fence_stride;
+            }
+            return size_t(((upper) ? std::upper_bound(a + s, a + e, v) : std::lower_bound(a + s, a + e, v)) - a);
+        }
+
+        /*
+         * Write the n points returned in ascending order by next() to a new
+         * file at path. The file is sized up front and mapped for writing.
+         * The points are streamed into x and level 0. Level min_level is
+         * level 0 sorted within runs of its nodes and every higher level is
+         * merged from the previous one, setting its bridges. The levels
+         * below the top alternate in two scratch arrays past the end of the
+         * file, cut off once done, so no array of the points is held in
+         * memory.
+         */
+        template<typename Source>
+        static void write(const std::string &path, const size_t n, Source &&next, const uint64_t generation) {
+            uint32_t levels = 1;
+            while ((size_t(1) << (levels - 1)) < n)
+                ++levels;
+            const uint32_t top = levels - 1;
+            const size_t stride = aligned(n * sizeof(Coord));
+
+            file_header header = {};
+            std::memcpy(header.magic, magic, sizeof(magic));
+            header.size = n;
+            header.coord_bytes = sizeof(Coord);
+            header.levels = levels;
+            header.log_generation = generation;
+            header.fences_offset = aligned(sizeof(file_header));
+            header.xs_offset = header.fences_offset + aligned(3 * fence_count(n) * sizeof(Coord));
+            header.ys_offset = header.xs_offset + stride;
+            header.top_offset = header.ys_offset + stride;
+            header.bridges_offset = header.top_offset + stride;
+            const size_t bytes = header.bridges_offset + bridged_levels(levels) * bridge_stride(n);
+            const size_t scratch_bytes = (top > min_level) ? 2 * stride : 0;
+
+            const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+                throw std::system_error(errno, std::generic_category(), path);
+            void *map = (::ftruncate(fd, off_t(bytes + scratch_bytes)) == 0) ?
+                        ::mmap(nullptr, bytes + scratch_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+            if (map == MAP_FAILED) {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), path);
+            }
+            // Written once front to back.
+            ::madvise(map, bytes + scratch_bytes, MADV_SEQUENTIAL);
+
+            char *file = static_cast<char *>(map);
+            std::memcpy(file, &header, sizeof(header));
+            Coord *fences = reinterpret_cast<Coord *>(file + header.fences_offset);
+            Coord *xs = reinterpret_cast<Coord *>(file + header.xs_offset);
+            Coord *ys = reinterpret_cast<Coord *>(file + header.ys_offset);
+            Coord *top_ys = reinterpret_cast<Coord *>(file + header.top_offset);
+            for (size_t i = 0; i < n; ++i) {
+                const point_type p = next();
+                xs[i] = p[0];
+                ys[i] = p[1];
+            }
+            if (top <= min_level) {
+                // A single node above the scanned levels.
+                std::copy(ys, ys + n, top_ys);
+                std::sort(top_ys, top_ys + n);
+            } else {
+                Coord *scratch[2] = {reinterpret_cast<Coord *>(file + bytes),
+                                     reinterpret_cast<Coord *>(file + bytes + stride)};
+                // Runs of level 0 sorted, the levels in between are not needed.
+                Coord *level = scratch[min_level % 2];
+                std::copy(ys, ys + n, level);
+                for (size_t s = 0; s < n; s += size_t(1) << min_level)
+                    std::sort(level + s, level + std::min(s + (size_t(1) << min_level), n));
+                for (uint32_t k = min_level + 1; k <= top; ++k) {
+                    // Runs of level k are merged pairs of runs of level k - 1.
+                    const Coord *previous = level;
+                    level = (k == top) ? top_ys : scratch[k % 2];
+                    layered_bridge_word *bridges = reinterpret_cast<layered_bridge_word *>(
+                            file + header.bridges_offset + (k - min_level - 1) * bridge_stride(n));
+                    const size_t half = size_t(1) << (k - 1);
+                    for (size_t s = 0; s < n; s += 2 * half) {
+                        const size_t m = std::min(s + half, n), e = std::min(s + 2 * half, n);
+                        for (size_t i = s, j = m, out = s; out < e; ++out) {
+                            const bool from_left = j == e || (i < m && !(previous[j] < previous[i]));
+                            level[out] = (from_left) ? previous[i++] : previous[j++];
+                            if (from_left)
+                                bridges[out / 64].bits |= uint64_t(1) << (out % 64);
+                        }
+                    }
+                    layered_bridge_ranks(bridges, n);
+                }
+            }
+            // Fences in file order -- x, y of level 0 and y of the top level.
+            fences = copy_fences(xs, n, fences);
+            fences = copy_fences(ys, n, fences);
+            copy_fences(top_ys, n, fences);
+            const bool synced = ::msync(map, bytes, MS_SYNC) == 0;
+            int error = errno;
+            ::munmap(map, bytes + scratch_bytes);
+            const bool cut = synced && ::ftruncate(fd, off_t(bytes)) == 0;
+            if (synced && !cut)
+                error = errno;
+            ::close(fd);
+            if (!cut)
+                throw std::system_error(error, std::generic_category(), path);
+            sync(path);
+        }
+
+        // Copy every fence_stride-th coordinate of a to fences, return the end of the copied fences.
+        static Coord *copy_fences(const Coord *a, const size_t n, Coord *fences) noexcept {
+            for (size_t i = 0; i < n; i += fence_stride)
+                *fences++ = a[i];
+            return fences;
+        }
+
+        static void sync(const std::string &path) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0 || ::fsync(fd) != 0) {
+                const int error = errno;
+                if (fd >= 0)
+                    ::close(fd);
+                throw std::system_error(error, std::generic_category(), path);
+            }
+            ::close(fd);
+        }
+
+        void map() {
+            const int fd = ::open(path_.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::system_error(errno, std::generic_category(), path_);
+            struct stat st = {};
+            if (::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(file_header)) {
+                ::close(fd);
+                throw std::runtime_error(path_ + " is not a mapped range tree.");
+            }
+            map_bytes_ = size_t(st.st_size);
+            map_ = ::mmap(nullptr, map_bytes_, PROT_READ, MAP_SHARED, fd, 0);
+            const int error = errno;
+            ::close(fd);
+            if (map_ == MAP_FAILED) {
+                map_ = nullptr;
+                throw std::system_error(error, std::generic_category(), path_);
+            }
+            // Queries touch a few blocks each, read-ahead would only waste the cache.
+            ::madvise(map_, map_bytes_, MADV_RANDOM);
+
+            std::memcpy(&header_, map_, sizeof(file_header));
+            const size_t n = size_t(header_.size);
+            if (std::memcmp(header_.magic, magic, sizeof(magic)) != 0 || header_.coord_bytes != sizeof(Coord) ||
+                header_.levels == 0 || header_.levels > 64 ||
+                header_.top_offset + n * sizeof(Coord) > map_bytes_ ||
+                header_.bridges_offset + bridged_levels(header_.levels) * bridge_stride(n) > map_bytes_) {
+                unmap();
+                throw std::runtime_error(path_ + " is not a mapped range tree.");
+            }
+            const char *bytes = static_cast<const char *>(map_);
+            fences_ = reinterpret_cast<const Coord *>(bytes + header_.fences_offset);
+            xs_ = reinterpret_cast<const Coord *>(bytes + header_.xs_offset);
+            ys_ = reinterpret_cast<const Coord *>(bytes + header_.ys_offset);
+            top_ = reinterpret_cast<const Coord *>(bytes + header_.top_offset);
+            bridges_ = reinterpret_cast<const layered_bridge_word *>(bytes + header_.bridges_offset);
+        }
+
+        void unmap() noexcept {
+            if (map_)
+                ::munmap(map_, map_bytes_);
+            map_ = nullptr;
+            map_bytes_ = 0;
+        }
+
+        /*
+         * Load the log of the current file into the pending tree and open it
+         * for appending. A torn last record is cut off.
+         */
+        void replay_log() {
+            pending_points_.clear();
+            size_t log_bytes = 0;
+            {
+                std::ifstream ifs(log_path(), std::ios::binary | std::ios::ate);
+                if (ifs)
+                    log_bytes = size_t(ifs.tellg());
+                ifs.seekg(0);
+                point_type p;
+                while (ifs.read(reinterpret_cast<char *>(p.data()), sizeof(point_type)))
+                    pending_points_.push_back(p);
+            }
+            if (log_bytes != pending_points_.size() * sizeof(point_type) &&
+                ::truncate(log_path().c_str(), off_t(pending_points_.size() * sizeof(point_type))) != 0)
+                throw std::system_error(errno, std::generic_category(), log_path());
+            pending_.assign(pending_points_);
+            log_.open(log_path(), std::ios::binary | std::ios::app);
+            if (!log_)
+                throw std::runtime_error("Cannot open " + log_path());
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_MAPPED_RANGE_TREE_H
@@ -0,0 +1,104 @@
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include "bbalpha_tree.h"
+#include "kd_range_tree.h"
+#include "offline_range_count.h"
+
+using namespace rt;
+using namespace std;
+
+template<typename Out>
+void split(const string &s, const char& delimiter, Out&& result) {
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, delimiter)) {
+        if (!item.empty())
+            *(result++) = item;
+    }
+}
+
+vector<string> split(const string &s, const char& delimiter) {
+    vector<string> elems;
+    split(s, delimiter, back_inserter(elems));
+    return elems;
+}
+
+/*
+ * Answer the queries of one run offline and, when checking, compare them
+ * with the dynamic range tree replaying the same inserts.
+ */
+void run(ofstream& ofs, offline_range_count<>& engine, const size_t n, const bool check) {
+    auto start = chrono::steady_clock::now();
+    auto counts = engine.run();
+    auto end = chrono::steady_clock::now();
+    int_least64_t sum = 0;
+    for (auto c : counts)
+        sum += c;
+    ofs << n << " " << engine.queries().size() << " " << sum << " " << chrono::duration<double>(end - start).count();
+
+    if (check) {
+        statistics_ s;
+        range_tree<2> tree(0.7, s);
+        size_t mismatches = 0;
+        size_t inserted = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            for (; inserted < engine.times()[i]; ++inserted)
+                tree.insert(engine.points()[inserted]);
+            const auto &q = engine.queries()[i];
+            if (tree.range_query(q.lo, q.hi) != counts[i])
+                ++mismatches;
+        }
+        ofs << " " << mismatches;
+    }
+    ofs << endl;
+}
+
+/*
+ * Reads the trace format of main.cpp -- "# N" starts a run, "I x y" adds
+ * a point and "C x1 y1 x2 y2" a query. As in the dynamic tree, a query
+ * counts the points of the run inserted before it.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        cout << "Arguments -- output file name [check]." << endl;
+        throw 1;
+    }
+    const bool check = argc == 3 && string(argv[2]) == "check";
+    string line;
+    size_t last_n = 0;
+    auto first = true;
+    ofstream ofs{ argv[1] };
+    offline_range_count<> engine;
+    uint tree_count = 1;
+
+    ofs << "#N queries count_sum seconds" << ((check) ? " mismatches" : "") << endl;
+
+    while (!getline(cin, line).eof()) {
+        auto tokens = split(line, ' ');
+        if (tokens.empty())
+            continue;
+
+        if (tokens[0] == string("#")) {
+            if (!first) {
+                run(ofs, engine, last_n, check);
+                cout << "TREE " << tree_count << " FINISHED!" << endl;
+                ++tree_count;
+            }
+            last_n = size_t(stoi(tokens[1]));
+            engine.clear();
+            first = false;
+        }
+        else if (tokens[0] == string("I")) {
+            engine.add_point(stoi(tokens[1]), stoi(tokens[2]));
+        }
+        else { // if (tokens[0] == string("C")) {
+            engine.add_query(stoi(tokens[1]), stoi(tokens[2]), stoi(tokens[3]), stoi(tokens[4]));
+        }
+    }
+    run(ofs, engine, last_n, check);
+    cout << "TREE " << tree_count << " FINISHED!" << endl;
+    cout << "END OF INPUT" << endl;
+}
@@ -0,0 +1,199 @@
+#ifndef DATA_STRUCTURES_OFFLINE_RANGE_COUNT_H
+#define DATA_STRUCTURES_OFFLINE_RANGE_COUNT_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <algorithm>
+
+namespace rt {
+
+    /*
+     * Fenwick (binary indexed) tree of counts over positions [0, n) in one
+     * flat array.
+     */
+    class fenwick_tree {
+    public:
+        explicit fenwick_tree(const size_t n) : counts_(n + 1, 0) {}
+
+        void add(size_t position, const int_least32_t delta) noexcept {
+            for (++position; position < counts_.size(); position += position & (~position + 1))
+                counts_[position] += delta;
+        }
+
+        // Sum of counts at positions [0, end).
+        int_least32_t prefix(size_t end) const noexcept {
+            int_least32_t sum = 0;
+            for (; end > 0; end -= end & (~end + 1))
+                sum += counts_[end];
+            return sum;
+        }
+
+    private:
+        std::vector<int_least32_t> counts_;
+    };
+
+    /*
+     * Offline 2D range counting, for the case when all points and all
+     * queries are known in advance. A query counts the points added before
+     * it, as in the dynamic tree. Every query count is split into the
+     * points with x <= x2 minus the points with x < x1, both within
+     * [y1, y2]. Those two are answered by sweeping over points sorted by x
+     * with a Fenwick tree over compressed y coordinates of points added so
+     * far. When all queries come after all points, one sweep takes
+     * O((n + q) log n). Otherwise the sequence of points and queries is
+     * halved in time (CDQ divide and conquer): points of the first half are
+     * swept with the queries of the second half, and both halves are solved
+     * recursively, O((n + q) log^2 n) in total. Only flat arrays are used.
+     */
+    template<typename Coord = int_least32_t>
+    class offline_range_count {
+    public:
+        using point_type = std::array<Coord, 2>;
+
+        struct rect {
+            point_type lo;
+            point_type hi;
+        };
+
+        void add_point(const Coord x, const Coord y) {
+            points_.push_back({x, y});
+        }
+
+        void add_query(const Coord x1, const Coord y1, const Coord x2, const Coord y2) {
+            queries_.push_back({{x1, y1}, {x2, y2}});
+            times_.push_back(points_.size());
+        }
+
+        const std::vector<point_type> &points() const noexcept { return points_; }
+
+        const std::vector<rect> &queries() const noexcept { return queries_; }
+
+        // Number of points added before each query.
+        const std::vector<size_t> &times() const noexcept { return times_; }
+
+        void clear() {
+            points_.clear();
+            queries_.clear();
+            times_.clear();
+        }
+
+        /*
+         * Return number of points p with lo[i] <= p[i] <= hi[i] among the
+         * points added before the query, for every added query in the order
+         * the queries were added.
+         */
+        std::vector<int_least32_t> run() {
+            std::vector<int_least32_t> counts(queries_.size(), 0);
+            ys_.resize(points_.size());
+            for (size_t i = 0; i < points_.size(); ++i)
+                ys_[i] = points_[i][1];
+            std::sort(ys_.begin(), ys_.end());
+            ys_.erase(std::unique(ys_.begin(), ys_.end()), ys_.end());
+
+            // Points and query events in the order they were added, a query before the point of its time.
+            std::vector<event> events;
+            events.reserve(points_.size() + 2 * queries_.size());
+            bool interleaved = false;
+            for (size_t i = 0, q = 0; i <= points_.size(); ++i) {
+                for (; q < queries_.size() && times_[q] == i; ++q) {
+                    const rect &r = queries_[q];
+                    if (r.hi[0] < r.lo[0] || r.hi[1] < r.lo[1])
+                        continue;
+                    interleaved = interleaved || i < points_.size();
+                    events.push_back({r.lo[0], event::exclusive, int_least32_t(q)});
+                    events.push_back({r.hi[0], event::inclusive, int_least32_t(q)});
+                }
+                if (i < points_.size())
+                    events.push_back({points_[i][0], event::point, int_least32_t(i)});
+            }
+
+            fenwick_tree tree(ys_.size());
+            if (interleaved) {
+                std::vector<event> scratch(events.size());
+                divide(events.data(), events.size(), scratch.data(), tree, counts);
+            } else {
+                std::sort(events.begin(), events.end());
+                for (const event &e : events) {
+                    if (e.kind == event::point)
+                        add(tree, e, 1);
+                    else
+                        answer(tree, e, counts);
+                }
+            }
+            return counts;
+        }
+
+    private:
+        struct event {
+            // Points with x < this x, points, points with x <= this x -- the order of equal x in a sweep.
+            enum kind_type : uint8_t { exclusive, point, inclusive };
+
+            Coord x;
+            kind_type kind;
+            int_least32_t index;  // Of the query or the point.
+
+            bool operator<(const event &other) const noexcept {
+                return x < other.x || (!(other.x < x) && kind < other.kind);
+            }
+        };
+
+        std::vector<point_type> points_;
+        std::vector<rect> queries_;
+        std::vector<size_t> times_;
+        // Compressed y coordinates of the points of the last run.
+        std::vector<Coord> ys_;
+
+        void add(fenwick_tree &tree, const event &e, const int_least32_t delta) const noexcept {
+            const Coord y = points_[size_t(e.index)][1];
+            tree.add(size_t(std::lower_bound(ys_.begin(), ys_.end(), y) - ys_.begin()), delta);
+        }
+
+        // Add points with x within the range of query event e to its count.
+        void answer(const fenwick_tree &tree, const event &e, std::vector<int_least32_t> &counts) const noexcept {
+            const rect &r = queries_[size_t(e.index)];
+            auto lo = size_t(std::lower_bound(ys_.begin(), ys_.end(), r.lo[1]) - ys_.begin());
+            auto hi = size_t(std::upper_bound(ys_.begin(), ys_.end(), r.hi[1]) - ys_.begin());
+            const int_least32_t inside = tree.prefix(hi) - tree.prefix(lo);
+            counts[size_t(e.index)] += (e.kind == event::inclusive) ? inside : -inside;
+        }
+
+        /*
+         * Answer query events of the n events at a, in the order they were
+         * added, by points before them, and leave the events sorted by x.
+         * The halves are solved and sorted recursively, then merged while the
+         * points of the first half are added to the tree and the query
+         * events of the second half read it. The points are removed again,
+         * so the tree is empty in between.
+         */
+        void divide(event *a, const size_t n, event *scratch, fenwick_tree &tree,
+                    std::vector<int_least32_t> &counts) const {
+            if (n < 2)
+                return;
+            const size_t half = n / 2;
+            divide(a, half, scratch, tree, counts);
+            divide(a + half, n - half, scratch, tree, counts);
+            size_t i = 0, j = half, out = 0;
+            while (i < half || j < n) {
+                if (j == n || (i < half && !(a[j] < a[i]))) {
+                    if (a[i].kind == event::point)
+                        add(tree, a[i], 1);
+                    scratch[out++] = a[i++];
+                } else {
+                    if (a[j].kind != event::point)
+                        answer(tree, a[j], counts);
+                    scratch[out++] = a[j++];
+                }
+            }
+            for (size_t k = 0; k < half; ++k) {
+                if (a[k].kind == event::point)
+                    add(tree, a[k], -1);
+            }
+            std::copy(scratch, scratch + n, a);
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_OFFLINE_RANGE_COUNT_H
@@ -0,0 +1,105 @@
+#ifndef DATA_STRUCTURES_PARALLEL_H
+#define DATA_STRUCTURES_PARALLEL_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+namespace rt {
+
+    /*
+     * Range of work items of one worker packed to a single atomic word, so
+     * that the owner taking from the front and thieves taking from the back
+     * never grab the same items.
+     */
+    class stealing_range {
+        std::atomic<uint_least64_t> range_{0};
+
+        static uint_least64_t pack(uint_least64_t begin, uint_least64_t end) noexcept { return (begin << 32) | end; }
+
+    public:
+        void reset(size_t begin, size_t end) noexcept {
+            range_.store(pack(begin, end));
+        }
+
+        // Take up to chunk items from the front, false if the range is empty.
+        bool take_front(size_t chunk, size_t &begin, size_t &end) noexcept {
+            auto current = range_.load();
+            uint_least64_t b, e;
+            do {
+                b = current >> 32;
+                e = current & 0xFFFFFFFFu;
+                if (b >= e)
+                    return false;
+            } while (!range_.compare_exchange_weak(current, pack(std::min<uint_least64_t>(b + chunk, e), e)));
+            begin = size_t(b);
+            end = size_t(std::min<uint_least64_t>(b + chunk, e));
+            return true;
+        }
+
+        // Take up to chunk items from the back, false if the range is empty.
+        bool take_back(size_t chunk, size_t &begin, size_t &end) noexcept {
+            auto current = range_.load();
+            uint_least64_t b, e;
+            do {
+                b = current >> 32;
+                e = current & 0xFFFFFFFFu;
+                if (b >= e)
+                    return false;
+            } while (!range_.compare_exchange_weak(current, pack(b, (e - b > chunk) ? e - chunk : b)));
+            begin = size_t((e - b > chunk) ? e - chunk : b);
+            end = size_t(e);
+            return true;
+        }
+    };
+
+    /*
+     * Process items [0, n) by worker_count threads (the calling one included).
+     * Items are split to one contiguous block per worker, prepare(begin, end)
+     * is called on each block by its owner first (e.g. to reorder the block
+     * for locality). Then every worker calls f(begin, end) on chunks from the
+     * front of its block and, when the block runs out, steals chunks from the
+     * back of the other blocks. Item count must fit into 32 bits.
+     */
+    template<typename Prepare, typename Lambda>
+    void work_stealing_for(const size_t n, unsigned worker_count, const size_t chunk, Prepare &&prepare, Lambda &&f) {
+        if (n == 0)
+            return;
+        worker_count = std::max(1u, std::min<unsigned>(worker_count, unsigned((n + chunk - 1) / chunk)));
+        std::unique_ptr<stealing_range[]> ranges(new stealing_range[worker_count]);
+        for (unsigned w = 0; w < worker_count; ++w)
+            ranges[w].reset(n * w / worker_count, n * (w + 1) / worker_count);
+        std::atomic<unsigned> prepared{0};
+
+        auto work = [&](const unsigned w) {
+            prepare(n * w / worker_count, n * (w + 1) / worker_count);
+            // Nobody may steal from a block which is not prepared yet.
+            ++prepared;
+            while (prepared.load() < worker_count)
+                std::this_thread::yield();
+            size_t begin, end;
+            while (ranges[w].take_front(chunk, begin, end))
+                f(begin, end);
+            for (unsigned i = 1; i < worker_count; ++i) {
+                auto &victim = ranges[(w + i) % worker_count];
+                while (victim.take_back(chunk, begin, end))
+                    f(begin, end);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(worker_count - 1);
+        for (unsigned w = 1; w < worker_count; ++w)
+            threads.emplace_back(work, w);
+        work(0);
+        for (auto &t : threads)
+            t.join();
+    }
+
+}
+
+#endif //DATA_STRUCTURES_PARALLEL_H
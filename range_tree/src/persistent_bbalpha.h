@@ -0,0 +1,392 @@
+#ifndef DATA_STRUCTURES_PERSISTENT_BBALPHA_H
+#define DATA_STRUCTURES_PERSISTENT_BBALPHA_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include "bbalpha_tree.h"
+
+namespace rt {
+
+    /*
+     * Structures kept in persistent_bbalpha nodes over the values of their
+     * subtrees, like aggregates in bbalpha nodes. An associated policy
+     * provides type and sequence, what a structure is built from. Subtrees
+     * are built bottom-up -- merge(right, left, value) returns the sequence
+     * of a node from the sequences of its subtrees and its value, and
+     * build(alpha, stats, sequence) the structure. insert(a, value) returns
+     * a new structure with value added while a stays untouched. The default
+     * one keeps nothing.
+     */
+    struct no_associated {
+        struct type {};
+        struct sequence {};
+        template<typename V>
+        static sequence merge(const sequence &, const sequence &, const V &) noexcept { return {}; }
+        static type build(double, statistics_ &, const sequence &) noexcept { return {}; }
+        template<typename V>
+        static type insert(const type &, const V &) noexcept { return {}; }
+    };
+
+    /*
+     * Persistent BB[alpha] tree. Every object is one version of the tree
+     * and insert returns a new version while the old one stays valid.
+     * Nodes are immutable and shared among versions. Insert copies only the
+     * path from the root to the new node, and a rebuild creates a new
+     * subtree instead of relinking the existing nodes. Each node counts the
+     * parents and versions referencing it, so a node is freed when the last
+     * version using it is destroyed.
+     *
+     * Values, keys, ordering and ranks are those of bbalpha with the same
+     * Compare and KeyOf -- larger keys (and equal ones on insert) go to the
+     * right subtree. Every node also keeps a structure of the Associated
+     * policy over its subtree, copied nodes get it from Associated::insert.
+     * Like bbalpha::insert, insert does not finish the operation in stats,
+     * the caller does.
+     */
+    template<typename T, typename Associated = no_associated, typename Compare = std::less<>,
+            typename KeyOf = identity_key>
+    class persistent_bbalpha {
+        using base = bbalpha<T, no_aggregate, Compare, KeyOf>;
+
+    public:
+        using key_type = typename base::key_type;
+        using associated_type = typename Associated::type;
+
+        class node : private compressed_value<associated_type>, public keyed_value<T, KeyOf> {
+        public:
+            node *const right;
+            node *const left;
+            const int_least32_t subtree_size;
+
+            node(const T &v, node *r, node *l, const int_least32_t size, const associated_type &a) :
+                    compressed_value<associated_type>(a), keyed_value<T, KeyOf>(v),
+                    right(acquire(r)), left(acquire(l)), subtree_size(size) {}
+            node(const node &other) = delete;
+            node &operator=(const node &other) = delete;
+            // Associated structure over values of the whole subtree.
+            decltype(auto) associated() const noexcept {
+                return compressed_value<associated_type>::get();
+            }
+
+        private:
+            friend class persistent_bbalpha;
+            mutable std::atomic<int_least32_t> references_{0};
+        };
+
+        const double alpha;
+        statistics_ &stats;
+
+        // Empty version.
+        persistent_bbalpha(double a, statistics_ &s) : alpha(a), stats(s) {}
+
+        // Version of a perfectly balanced tree of *sorted[i], in descending order.
+        persistent_bbalpha(double a, statistics_ &s, const std::vector<const T *> &sorted) :
+                alpha(a), stats(s), tree_(acquire(build(sorted))) {}
+
+        // O(1), the versions share all nodes.
+        persistent_bbalpha(const persistent_bbalpha &other) :
+                alpha(other.alpha), stats(other.stats), tree_(acquire(other.tree_)) {}
+
+        persistent_bbalpha(persistent_bbalpha &&other) noexcept :
+                alpha(other.alpha), stats(other.stats), tree_(other.tree_) {
+            other.tree_ = nullptr;
+        }
+
+        // Versions of one tree only, alpha and statistics are not reassigned.
+        persistent_bbalpha &operator=(const persistent_bbalpha &other) {
+            node *old = tree_;
+            tree_ = acquire(other.tree_);
+            release(old);
+            return *this;
+        }
+
+        ~persistent_bbalpha() {
+            release(tree_);
+        }
+
+        const node *root() const noexcept { return tree_; }
+
+        int_least32_t elements_count() const noexcept { return (tree_) ? tree_->subtree_size : 0; }
+
+        /*
+         * Return a new version with val inserted. Nodes on the search path
+         * are copied with subtree sizes increased by one. If a copy would be
+         * out of balance, the subtree of the highest such one is built as
+         * perfectly balanced from new nodes instead of being copied.
+         */
+        persistent_bbalpha insert(const T &val) const {
+            const key_type key = KeyOf()(val);
+            std::vector<node *> path;
+            for (node *n = tree_; n; n = (!less(key, n->key())) ? n->right : n->left) {
+                stats.record(true, false);
+                path.push_back(n);
+            }
+            // Sizes of the copies are known in advance, so the highest
+            // unbalanced one is found before anything is allocated.
+            size_t highest_unbalanced = path.size();
+            for (size_t i = path.size(); i-- > 0;) {
+                stats.record(true, false);
+                const node *old = path[i];
+                const bool to_right = !less(key, old->key());
+                const int_least32_t size = old->subtree_size + 1;
+                const int_least32_t grown = (i + 1 < path.size()) ? path[i + 1]->subtree_size + 1 : 1;
+                const int_least32_t r_size = (to_right) ? grown : size_of(old->right);
+                const int_least32_t l_size = (to_right) ? size_of(old->left) : grown;
+                if (r_size > alpha * size || l_size > alpha * size)
+                    highest_unbalanced = i;
+            }
+            node *child;
+            if (highest_unbalanced < path.size())
+                child = rebuild(path[highest_unbalanced], val);
+            else
+                child = build(std::vector<const T *>{&val});
+            for (size_t i = std::min(highest_unbalanced, path.size()); i-- > 0;) {
+                const node *old = path[i];
+                const bool to_right = !less(key, old->key());
+                child = new node(old->value, (to_right) ? child : old->right, (to_right) ? old->left : child,
+                                 old->subtree_size + 1, Associated::insert(old->associated(), val));
+            }
+            persistent_bbalpha result(alpha, stats);
+            result.tree_ = acquire(child);
+            return result;
+        }
+
+        /*
+         * Return number of values lo <= value <= hi in this version, visits
+         * are recorded to s.
+         */
+        int_least32_t range_count(const key_type &lo, const key_type &hi, statistics_ &s) const {
+            int_least32_t count = (less(hi, lo)) ? 0 : rank(hi, true, s) - rank(lo, false, s);
+            s.record(false, true);
+            return count;
+        }
+
+        int_least32_t range_count(const key_type &lo, const key_type &hi) const {
+            return range_count(lo, hi, stats);
+        }
+
+        /*
+         * Return number of values < x (<= x if inclusive), recording visits
+         * to s without finishing the operation.
+         */
+        int_least32_t rank(const key_type &x, const bool inclusive, statistics_ &s) const {
+            return base::subtree_rank(tree_, x, inclusive, [&s]() { s.record(false, false); });
+        }
+
+    private:
+        node *tree_ = nullptr;
+
+        static bool less(const key_type &a, const key_type &b) noexcept {
+            return Compare()(a, b);
+        }
+
+        static node *acquire(node *n) noexcept {
+            if (n)
+                n->references_.fetch_add(1, std::memory_order_relaxed);
+            return n;
+        }
+
+        // Children of freed nodes are released with an explicit stack.
+        static void release(node *n) {
+            std::vector<node *> stack;
+            while (n) {
+                if (n->references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (n->right)
+                        stack.push_back(n->right);
+                    if (n->left)
+                        stack.push_back(n->left);
+                    delete n;
+                }
+                n = nullptr;
+                if (!stack.empty()) {
+                    n = stack.back();
+                    stack.pop_back();
+                }
+            }
+        }
+
+        static int_least32_t size_of(const node *n) noexcept {
+            return (n) ? n->subtree_size : 0;
+        }
+
+        /*
+         * Return a perfectly balanced subtree of new nodes with values of the
+         * subtree of n and val, n itself stays untouched.
+         */
+        node *rebuild(const node *n, const T &val) const {
+            std::vector<const T *> sorted;
+            sorted.reserve(size_t(n->subtree_size) + 1);
+            // Descending order, as bbalpha::sort_tree does.
+            typename base::template inorder_iterator<const node> it(n);
+            for (const node *m; (m = it.next());)
+                sorted.push_back(&m->value);
+            stats.record(true, false, uint_least32_t(sorted.size()));
+            // Val goes after all values with keys not smaller than its key.
+            const key_type key = KeyOf()(val);
+            auto position = std::find_if(sorted.begin(), sorted.end(), [&key](const T *v) {
+                return less(KeyOf()(*v), key);
+            });
+            sorted.insert(position, &val);
+            return build(sorted);
+        }
+
+        node *build(const std::vector<const T *> &sorted) const {
+            typename Associated::sequence unused;
+            return build(sorted, 0, int_least32_t(sorted.size()), unused);
+        }
+
+        /*
+         * The middle value at the root, larger values to the right, as
+         * bbalpha::build_t does. Associated structures are built bottom-up,
+         * sequence is set to the one of the subtree.
+         */
+        node *build(const std::vector<const T *> &sorted, const int_least32_t begin, const int_least32_t end,
+                    typename Associated::sequence &sequence) const {
+            if (begin >= end) {
+                sequence = typename Associated::sequence();
+                return nullptr;
+            }
+            stats.record(true, false);
+            int_least32_t half = begin + int_least32_t((end - begin) / 2);
+            typename Associated::sequence right_sequence, left_sequence;
+            node *right = build(sorted, begin, half, right_sequence);
+            node *left = build(sorted, half + 1, end, left_sequence);
+            sequence = Associated::merge(right_sequence, left_sequence, *sorted[half]);
+            return new node(*sorted[half], right, left, end - begin, Associated::build(alpha, stats, sequence));
+        }
+    };
+
+    /*
+     * Persistent 2D range tree, every object is one version as in
+     * persistent_bbalpha. The x-tree is a persistent_bbalpha of points keyed
+     * by x whose every node keeps a persistent_bbalpha of the y
+     * coordinates of its subtree. Insert copies the O(log n) x-nodes of the
+     * path and inserts y into the version of each of them, so it allocates
+     * O(log^2 n) nodes besides rebuilds, and a range count takes
+     * O(log^2 n).
+     */
+    template<typename Coord = int_least32_t>
+    class persistent_range_tree {
+    public:
+        using point_type = std::array<Coord, 2>;
+
+    private:
+        struct x_of {
+            const Coord &operator()(const point_type &p) const noexcept { return p[0]; }
+        };
+
+        // Version of y coordinates of the points of a subtree.
+        struct y_versions {
+            using type = persistent_bbalpha<Coord>;
+
+            // Descending y, merged from the subtrees as kd range_tree::build_lower does.
+            using sequence = std::vector<Coord>;
+
+            static sequence merge(const sequence &right, const sequence &left, const point_type &p) {
+                return merge_subtree(right, left, p[1], std::greater<>());
+            }
+
+            static type build(double alpha, statistics_ &s, const sequence &ys) {
+                std::vector<const Coord *> sorted;
+                sorted.reserve(ys.size());
+                for (const Coord &y : ys)
+                    sorted.push_back(&y);
+                return type(alpha, s, sorted);
+            }
+
+            static type insert(const type &a, const point_type &p) {
+                return a.insert(p[1]);
+            }
+        };
+
+        using x_tree = persistent_bbalpha<point_type, y_versions, std::less<>, x_of>;
+        using node = typename x_tree::node;
+
+    public:
+        // Empty version.
+        persistent_range_tree(double a, statistics_ &s) : tree_(a, s) {}
+
+        int_least32_t elements_count() const noexcept { return tree_.elements_count(); }
+
+        /*
+         * Return a new version with the point inserted. As in
+         * persistent_bbalpha, the caller finishes the operation in stats.
+         */
+        persistent_range_tree insert(const Coord x, const Coord y) const {
+            return persistent_range_tree(tree_.insert(point_type{x, y}));
+        }
+
+        /*
+         * Return number of points with x1 <= x <= x2 and y1 <= y <= y2 in
+         * this version, visits are recorded to s. Below the split node of
+         * [x1, x2], the y versions of subtrees hanging inside of the range
+         * along both paths are counted.
+         */
+        int_least32_t range_count(const Coord x1, const Coord y1, const Coord x2, const Coord y2,
+                                  statistics_ &s) const {
+            int_least32_t result = 0;
+            if (!(x2 < x1) && !(y2 < y1))
+                result = count(x1, y1, x2, y2, s);
+            s.record(false, true);
+            return result;
+        }
+
+        int_least32_t range_count(const Coord x1, const Coord y1, const Coord x2, const Coord y2) const {
+            return range_count(x1, y1, x2, y2, tree_.stats);
+        }
+
+    private:
+        x_tree tree_;
+
+        explicit persistent_range_tree(x_tree t) : tree_(std::move(t)) {}
+
+        int_least32_t count(const Coord x1, const Coord y1, const Coord x2, const Coord y2, statistics_ &s) const {
+            const node *split = tree_.root();
+            while (split) {
+                s.record(false, false);
+                if (split->key() < x1)
+                    split = split->right;
+                else if (x2 < split->key())
+                    split = split->left;
+                else
+                    break;
+            }
+            if (!split)
+                return 0;
+            auto point = [y1, y2](const node *n) {
+                return int_least32_t(!(n->value[1] < y1) && !(y2 < n->value[1]));
+            };
+            auto subtree = [y1, y2, &s](const node *n) {
+                return (n) ? n->associated().rank(y2, true, s) - n->associated().rank(y1, false, s) : 0;
+            };
+            int_least32_t result = point(split);
+            for (const node *v = split->left; v;) {
+                s.record(false, false);
+                if (!(v->key() < x1)) {
+                    result += point(v) + subtree(v->right);
+                    v = v->left;
+                } else {
+                    v = v->right;
+                }
+            }
+            for (const node *v = split->right; v;) {
+                s.record(false, false);
+                if (!(x2 < v->key())) {
+                    result += point(v) + subtree(v->left);
+                    v = v->right;
+                } else {
+                    v = v->left;
+                }
+            }
+            return result;
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_PERSISTENT_BBALPHA_H
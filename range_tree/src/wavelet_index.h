@@ -0,0 +1,348 @@
+#ifndef DATA_STRUCTURES_WAVELET_INDEX_H
+#define DATA_STRUCTURES_WAVELET_INDEX_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+namespace rt {
+
+    /*
+     * Static bitvector with rank in O(1) and select in O(log n). Every
+     * block of four 64-bit words stores the number of ones before it, rank
+     * adds popcounts of the words before the position within its block.
+     * Takes n + n / 8 bits.
+     */
+    class rank_bitvector {
+    public:
+        rank_bitvector() = default;
+        explicit rank_bitvector(const size_t n) : size_(n), words_((n + 63) / 64 + 1, 0) {}
+
+        size_t size() const noexcept { return size_; }
+
+        void set(const size_t i) noexcept {
+            words_[i / 64] |= uint64_t(1) << (i % 64);
+        }
+
+        bool get(const size_t i) const noexcept {
+            return (words_[i / 64] >> (i % 64)) & 1;
+        }
+
+        // Must be called after the last set and before rank or select.
+        void build() {
+            blocks_.assign(words_.size() / words_per_block + 1, 0);
+            uint32_t ones = 0;
+            for (size_t w = 0; w < words_.size(); ++w) {
+                if (w % words_per_block == 0)
+                    blocks_[w / words_per_block] = ones;
+                ones += popcount(words_[w]);
+            }
+            // The block past the last word, if any, for select to stay sorted.
+            if (words_.size() % words_per_block == 0)
+                blocks_.back() = ones;
+            ones_ = ones;
+        }
+
+        // Number of ones at positions [0, i).
+        size_t rank1(const size_t i) const noexcept {
+            const size_t word = i / 64;
+            size_t r = blocks_[word / words_per_block];
+            for (size_t w = word - word % words_per_block; w < word; ++w)
+                r += popcount(words_[w]);
+            const uint64_t below = (uint64_t(1) << (i % 64)) - 1;
+            return r + popcount(words_[word] & below);
+        }
+
+        // Number of zeros at positions [0, i).
+        size_t rank0(const size_t i) const noexcept { return i - rank1(i); }
+
+        size_t ones() const noexcept { return ones_; }
+
+        /*
+         * Position of the k-th one (counted from 0), k < ones(). Binary
+         * search over blocks, then over popcounts of its words and bits.
+         */
+        size_t select1(size_t k) const noexcept {
+            size_t block = size_t(std::upper_bound(blocks_.begin(), blocks_.end(), uint32_t(k)) - blocks_.begin()) - 1;
+            k -= blocks_[block];
+            size_t w = block * words_per_block;
+            for (size_t c; (c = popcount(words_[w])) <= k; ++w)
+                k -= c;
+            uint64_t word = words_[w];
+            for (; k > 0; --k)
+                word &= word - 1;  // Clear the lowest one.
+            return w * 64 + size_t(__builtin_ctzll(word));
+        }
+
+        /*
+         * Position of the k-th zero (counted from 0), k < size() - ones().
+         * Zeros before a block follow from its position and ones.
+         */
+        size_t select0(size_t k) const noexcept {
+            size_t lo = 0, hi = blocks_.size();
+            while (hi - lo > 1) {
+                const size_t mid = (lo + hi) / 2;
+                if (mid * words_per_block * 64 - blocks_[mid] <= k)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            k -= lo * words_per_block * 64 - blocks_[lo];
+            size_t w = lo * words_per_block;
+            for (size_t c; (c = popcount(~words_[w])) <= k; ++w)
+                k -= c;
+            uint64_t word = ~words_[w];
+            for (; k > 0; --k)
+                word &= word - 1;
+            return w * 64 + size_t(__builtin_ctzll(word));
+        }
+
+        size_t memory_footprint() const noexcept {
+            return sizeof(*this) + words_.capacity() * sizeof(uint64_t) + blocks_.capacity() * sizeof(uint32_t);
+        }
+
+    private:
+        static constexpr size_t words_per_block = 4;
+
+        size_t size_ = 0;
+        size_t ones_ = 0;
+        // One more word than needed, rank may read the word at position size_.
+        std::vector<uint64_t> words_;
+        std::vector<uint32_t> blocks_;
+
+        static size_t popcount(const uint64_t w) noexcept {
+            return size_t(__builtin_popcountll(w));
+        }
+    };
+
+    /*
+     * Sorted sequence of integer coordinates in Elias-Fano encoding. Values
+     * are offset by the minimum, the low bits of each are packed in an
+     * array, the high bits are unary coded in a rank_bitvector -- the i-th
+     * value sets bit high + i, so the zeros separate buckets of equal high
+     * bits. The bucket of a value is found by two select0, then its low
+     * bits are binary searched within the bucket. Takes about 2 + log2(u/n)
+     * bits per value for n values spanning u.
+     */
+    template<typename Coord>
+    class elias_fano {
+        static_assert(std::is_integral<Coord>::value, "Elias-Fano encoding needs integer coordinates.");
+
+    public:
+        elias_fano() = default;
+
+        // Values must be sorted ascending.
+        explicit elias_fano(const std::vector<Coord> &values) : size_(values.size()) {
+            if (values.empty())
+                return;
+            min_ = values.front();
+            max_ = values.back();
+            const uint64_t span = offset(max_);
+            while (low_bits_ < 63 && (span >> low_bits_) > size_)
+                ++low_bits_;
+            lows_.assign((size_ * low_bits_ + 63) / 64 + 1, 0);
+            highs_ = rank_bitvector(size_ + size_t(span >> low_bits_) + 1);
+            for (size_t i = 0; i < size_; ++i) {
+                const uint64_t v = offset(values[i]);
+                highs_.set(size_t(v >> low_bits_) + i);
+                set_low(i, v & low_mask());
+            }
+            highs_.build();
+        }
+
+        size_t size() const noexcept { return size_; }
+
+        Coord operator[](const size_t i) const noexcept {
+            const uint64_t high = highs_.select1(i) - i;
+            return Coord(uint64_t(min_) + ((high << low_bits_) | low(i)));
+        }
+
+        // Number of values < x.
+        size_t lower_bound(const Coord x) const noexcept {
+            if (size_ == 0 || !(min_ < x))
+                return 0;
+            return (max_ < x) ? size_ : rank(offset(x));
+        }
+
+        // Number of values <= x.
+        size_t upper_bound(const Coord x) const noexcept {
+            if (size_ == 0 || x < min_)
+                return 0;
+            return (x < max_) ? rank(offset(x) + 1) : size_;
+        }
+
+        size_t memory_footprint() const noexcept {
+            return sizeof(*this) + lows_.capacity() * sizeof(uint64_t) + highs_.memory_footprint() - sizeof(highs_);
+        }
+
+    private:
+        size_t size_ = 0;
+        Coord min_ = Coord();
+        Coord max_ = Coord();
+        uint32_t low_bits_ = 0;
+        // One more word than needed, a value may be read from two words.
+        std::vector<uint64_t> lows_;
+        rank_bitvector highs_;
+
+        uint64_t offset(const Coord x) const noexcept { return uint64_t(x) - uint64_t(min_); }
+
+        uint64_t low_mask() const noexcept { return (uint64_t(1) << low_bits_) - 1; }
+
+        uint64_t low(const size_t i) const noexcept {
+            if (low_bits_ == 0)
+                return 0;
+            const size_t bit = i * low_bits_;
+            uint64_t v = lows_[bit / 64] >> (bit % 64);
+            if (bit % 64 + low_bits_ > 64)
+                v |= lows_[bit / 64 + 1] << (64 - bit % 64);
+            return v & low_mask();
+        }
+
+        void set_low(const size_t i, const uint64_t v) noexcept {
+            if (low_bits_ == 0)
+                return;
+            const size_t bit = i * low_bits_;
+            lows_[bit / 64] |= v << (bit % 64);
+            if (bit % 64 + low_bits_ > 64)
+                lows_[bit / 64 + 1] |= v >> (64 - bit % 64);
+        }
+
+        // Number of values < v for offset v within the span.
+        size_t rank(const uint64_t v) const noexcept {
+            const size_t high = size_t(v >> low_bits_);
+            if (high >= highs_.size() - size_)
+                return size_;
+            // Values of the bucket are at positions [begin, end).
+            size_t begin = (high == 0) ? 0 : highs_.select0(high - 1) + 1 - high;
+            size_t end = highs_.select0(high) - high;
+            const uint64_t l = v & low_mask();
+            while (begin < end) {
+                const size_t mid = begin + (end - begin) / 2;
+                if (low(mid) < l)
+                    begin = mid + 1;
+                else
+                    end = mid;
+            }
+            return begin;
+        }
+    };
+
+    /*
+     * Static 2D range counting index. Points are sorted by x, their y are
+     * replaced by ranks among distinct y values (sigma of them) and stored
+     * in a wavelet matrix -- ceil(log2 sigma) rank bitvectors of n bits,
+     * level l stably partitioning the values by their l-th highest bit,
+     * zeros first. Counting values below v within a range of positions
+     * descends all levels with two ranks on each, so a query takes two
+     * searches in the coordinates and O(log sigma) ranks. Besides n log
+     * sigma bits (plus the rank directories) the index keeps sorted x and
+     * distinct y values, both Elias-Fano encoded, so x takes about
+     * 2 + log2(span / n) bits per point instead of a whole coordinate.
+     */
+    template<typename Coord = int_least32_t>
+    class wavelet_index {
+    public:
+        using point_type = std::array<Coord, 2>;
+
+        explicit wavelet_index(std::vector<point_type> points) {
+            std::sort(points.begin(), points.end());
+            std::vector<Coord> xs(points.size()), ys(points.size());
+            for (size_t i = 0; i < points.size(); ++i) {
+                xs[i] = points[i][0];
+                ys[i] = points[i][1];
+            }
+            xs_ = elias_fano<Coord>(xs);
+            std::sort(ys.begin(), ys.end());
+            ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+            ys_ = elias_fano<Coord>(ys);
+
+            std::vector<uint32_t> values(points.size());
+            for (size_t i = 0; i < points.size(); ++i)
+                values[i] = uint32_t(std::lower_bound(ys.begin(), ys.end(), points[i][1]) - ys.begin());
+            while ((size_t(1) << levels_count_) < ys.size())
+                ++levels_count_;
+
+            std::vector<uint32_t> next(values.size());
+            levels_.resize(levels_count_);
+            for (size_t l = 0; l < levels_count_; ++l) {
+                const size_t bit = levels_count_ - 1 - l;
+                rank_bitvector &level = levels_[l];
+                level = rank_bitvector(values.size());
+                size_t zeros = 0;
+                for (size_t i = 0; i < values.size(); ++i) {
+                    if ((values[i] >> bit) & 1)
+                        level.set(i);
+                    else
+                        next[zeros++] = values[i];
+                }
+                for (size_t i = 0, ones = zeros; i < values.size(); ++i) {
+                    if ((values[i] >> bit) & 1)
+                        next[ones++] = values[i];
+                }
+                level.build();
+                values.swap(next);
+            }
+        }
+
+        size_t size() const noexcept { return xs_.size(); }
+
+        /*
+         * Return number of points with x1 <= x <= x2 and y1 <= y <= y2.
+         */
+        int_least32_t range_query(const Coord x1, const Coord y1, const Coord x2, const Coord y2) const noexcept {
+            if (x2 < x1 || y2 < y1)
+                return 0;
+            const size_t l = xs_.lower_bound(x1);
+            const size_t r = xs_.upper_bound(x2);
+            const size_t a = ys_.lower_bound(y1);
+            const size_t b = ys_.upper_bound(y2);
+            if (l >= r || a >= b)
+                return 0;
+            return int_least32_t(count_less(l, r, b) - count_less(l, r, a));
+        }
+
+        // Bytes taken by the index.
+        size_t memory_footprint() const noexcept {
+            size_t bytes = sizeof(*this) + xs_.memory_footprint() + ys_.memory_footprint() - sizeof(xs_) - sizeof(ys_);
+            for (const auto &level : levels_)
+                bytes += level.memory_footprint();
+            return bytes;
+        }
+
+    private:
+        size_t levels_count_ = 0;
+        elias_fano<Coord> xs_;
+        // Distinct y values, the wavelet matrix holds their ranks.
+        elias_fano<Coord> ys_;
+        std::vector<rank_bitvector> levels_;
+
+        // Number of values < v at positions [l, r).
+        size_t count_less(size_t l, size_t r, const size_t v) const noexcept {
+            if (v >= (size_t(1) << levels_count_))
+                return r - l;
+            size_t result = 0;
+            for (size_t level = 0; level < levels_count_; ++level) {
+                const rank_bitvector &bits = levels_[level];
+                const size_t l0 = bits.rank0(l);
+                const size_t r0 = bits.rank0(r);
+                if ((v >> (levels_count_ - 1 - level)) & 1) {
+                    // Values with zero here are smaller, continue among the ones.
+                    result += r0 - l0;
+                    const size_t zeros = bits.size() - bits.ones();
+                    l = zeros + (l - l0);
+                    r = zeros + (r - r0);
+                } else {
+                    l = l0;
+                    r = r0;
+                }
+            }
+            return result;
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_WAVELET_INDEX_H
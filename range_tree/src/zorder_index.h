@@ -0,0 +1,214 @@
+#ifndef DATA_STRUCTURES_ZORDER_INDEX_H
+#define DATA_STRUCTURES_ZORDER_INDEX_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include "bbalpha_tree.h"
+#include "blocked_keys.h"
+
+namespace rt {
+
+    // Bits of v moved to the even positions of the result.
+    inline uint64_t morton_spread(const uint32_t v) noexcept {
+        uint64_t x = v;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x << 2)) & 0x3333333333333333ull;
+        x = (x | (x << 1)) & 0x5555555555555555ull;
+        return x;
+    }
+
+    // Inverse of morton_spread, odd bits of z are ignored.
+    inline uint32_t morton_compact(uint64_t z) noexcept {
+        z &= 0x5555555555555555ull;
+        z = (z | (z >> 1)) & 0x3333333333333333ull;
+        z = (z | (z >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+        z = (z | (z >> 4)) & 0x00FF00FF00FF00FFull;
+        z = (z | (z >> 8)) & 0x0000FFFF0000FFFFull;
+        z = (z | (z >> 16)) & 0x00000000FFFFFFFFull;
+        return uint32_t(z);
+    }
+
+    // Z-order key, x takes the even bits and y the odd ones.
+    inline uint64_t morton_encode(const uint32_t x, const uint32_t y) noexcept {
+        return morton_spread(x) | (morton_spread(y) << 1);
+    }
+
+    /*
+     * For z outside the box with corners zmin and zmax and zmin < z < zmax,
+     * find litmax, the largest key below z within the box, and bigmin, the
+     * smallest key above z within the box (Tropf and Herzog). Bits are
+     * examined from the highest one. Where zmin and zmax differ, the box is
+     * split to the lower and upper half in that dimension, and the one not
+     * containing z provides a bound.
+     */
+    inline void morton_split(const uint64_t z, uint64_t zmin, uint64_t zmax, uint64_t &litmax,
+                             uint64_t &bigmin) noexcept {
+        litmax = zmin;
+        bigmin = zmax;
+        for (int b = 63; b >= 0; --b) {
+            const uint64_t bit = uint64_t(1) << b;
+            // Lower bits of the same dimension.
+            const uint64_t below = ((b % 2) ? 0xAAAAAAAAAAAAAAAAull : 0x5555555555555555ull) & (bit - 1);
+            const int bits = ((z & bit) ? 4 : 0) | ((zmin & bit) ? 2 : 0) | ((zmax & bit) ? 1 : 0);
+            if (bits == 1) {
+                // z is in the lower half, the upper one starts at bigmin.
+                bigmin = (zmin | bit) & ~below;
+                zmax = (zmax & ~bit) | below;
+            } else if (bits == 3) {
+                bigmin = zmin;
+                return;
+            } else if (bits == 4) {
+                litmax = zmax;
+                return;
+            } else if (bits == 5) {
+                // z is in the upper half, the lower one ends at litmax.
+                litmax = (zmax & ~bit) | below;
+                zmin = (zmin | bit) & ~below;
+            }
+        }
+    }
+
+    /*
+     * 2D range counting over points sorted by their Z-order (Morton) key,
+     * which keeps points close in the plane mostly close in the array. Keys
+     * are kept in blocked_keys, a counted B+-tree of sorted arrays. A
+     * query counts keys between the Z-order keys of the rectangle corners,
+     * halving the position range: when the middle key lies within the
+     * rectangle, both halves are counted further. Otherwise the range is cut
+     * to the keys up to LITMAX and from BIGMIN, skipping the keys between
+     * which are all outside. A range whose smallest enclosing Z-order block
+     * lies within the rectangle is counted at once by its length, so a query
+     * only descends along the rectangle boundary where there are points.
+     */
+    template<typename Coord = int_least32_t>
+    class zorder_index {
+        static_assert(std::is_integral<Coord>::value && sizeof(Coord) <= 4, "Coordinates must be 32-bit integers.");
+
+    public:
+        using point_type = std::array<Coord, 2>;
+
+        statistics_ &stats;
+
+        explicit zorder_index(statistics_ &s, const int_least32_t block_size = 64) : stats(s), keys_(block_size) {}
+
+        int_least32_t size() const noexcept { return keys_.size(); }
+
+        void clear() {
+            std::vector<uint64_t> none;
+            keys_.assign(none.begin(), none.end());
+        }
+
+        void insert(const Coord x, const Coord y) {
+            keys_.insert(key(x, y));
+            stats.record(true, false, keys_.search_depth());
+            stats.record(true, true);
+        }
+
+        /*
+         * Replace the content by points.
+         */
+        void build(const std::vector<point_type> &points) {
+            std::vector<uint64_t> keys(points.size());
+            for (size_t i = 0; i < points.size(); ++i)
+                keys[i] = key(points[i][0], points[i][1]);
+            std::sort(keys.begin(), keys.end());
+            keys_.assign(keys.begin(), keys.end());
+        }
+
+        /*
+         * Return number of points with x1 <= x <= x2 and y1 <= y <= y2.
+         */
+        int_least32_t range_query(const Coord x1, const Coord y1, const Coord x2, const Coord y2) {
+            if (x2 < x1 || y2 < y1) {
+                stats.record(false, true);
+                return 0;
+            }
+            box b{ordered(x1), ordered(y1), ordered(x2), ordered(y2), 0, 0};
+            b.zmin = morton_encode(b.x1, b.y1);
+            b.zmax = morton_encode(b.x2, b.y2);
+            uint_least32_t visits = 1;
+            const int_least32_t result = count(b, keys_.rank(b.zmin, false), keys_.rank(b.zmax, true), b.zmin, b.zmax,
+                                               visits);
+            stats.record(false, false, visits);
+            stats.record(false, true);
+            return result;
+        }
+
+        // Bytes taken by the index.
+        size_t memory_footprint() const noexcept {
+            return sizeof(*this) - sizeof(keys_) + keys_.memory_footprint();
+        }
+
+    private:
+        struct box {
+            uint32_t x1, y1, x2, y2;
+            // Keys of the corners, the smallest and the largest key within.
+            uint64_t zmin, zmax;
+        };
+
+        blocked_keys<uint64_t> keys_;
+
+        // Order preserving map to unsigned 32 bits.
+        static uint32_t ordered(const Coord c) noexcept {
+            return uint32_t(int_least64_t(c) - int_least64_t(std::numeric_limits<Coord>::min()));
+        }
+
+        static uint64_t key(const Coord x, const Coord y) noexcept {
+            return morton_encode(ordered(x), ordered(y));
+        }
+
+        static bool inside(const box &b, const uint64_t z) noexcept {
+            const uint32_t x = morton_compact(z), y = morton_compact(z >> 1);
+            return b.x1 <= x && x <= b.x2 && b.y1 <= y && y <= b.y2;
+        }
+
+        // Whether all keys between zmin and zmax lie within the box.
+        static bool dense(const box &b, const uint64_t zmin, const uint64_t zmax) noexcept {
+            if (zmin == zmax)
+                return inside(b, zmin);
+            const int high = 63 - __builtin_clzll(zmin ^ zmax);
+            const uint64_t low = (high == 63) ? ~uint64_t(0) : (uint64_t(2) << high) - 1;
+            return inside(b, zmin & ~low) && inside(b, zmax | low);
+        }
+
+        /*
+         * Count keys within the box at positions [first, last), all of them
+         * between zmin and zmax, which lie within the box. LITMAX and BIGMIN
+         * are taken for the whole box, the nearest keys within it are also
+         * the nearest ones between zmin and zmax.
+         */
+        int_least32_t count(const box &b, int_least32_t first, const int_least32_t last, uint64_t zmin,
+                            const uint64_t zmax, uint_least32_t &visits) const {
+            int_least32_t result = 0;
+            while (first < last) {
+                ++visits;
+                if (dense(b, zmin, zmax))
+                    return result + last - first;
+                const int_least32_t middle = first + (last - first) / 2;
+                const uint64_t z = keys_.at(middle);
+                if (inside(b, z)) {
+                    result += 1 + count(b, first, middle, zmin, z, visits);
+                    first = middle + 1;
+                    zmin = z;
+                } else {
+                    uint64_t litmax, bigmin;
+                    morton_split(z, b.zmin, b.zmax, litmax, bigmin);
+                    result += count(b, first, keys_.rank(litmax, true), zmin, litmax, visits);
+                    first = keys_.rank(bigmin, false);
+                    zmin = bigmin;
+                }
+            }
+            return result;
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_ZORDER_INDEX_H
@@ -1,6 +1,8 @@
 #include "../src/bbalpha_tree.h"
 #include "gtest/gtest.h"
 #include <limits>
+#include <algorithm>
+#include <string>
 
 using namespace std;
 using namespace rt;
@@ -107,6 +109,210 @@ TEST(BBTreeTests, InsertSameDuplicity) {
     tree.clear();
 }
 
+TEST(BBTreeTests, RangeReport) {
+    statistics_ s;
+    bbalpha<int> tree(0.65f, s);
+    for (int v : {5, 3, 9, 1, 7, 3, 8, 2, 6, 4, 10, 3})
+        tree.insert(v);
+    vector<int> reported;
+    auto count = tree.range_report(3, 7, [&reported](node *n) { reported.push_back(n->value); });
+    EXPECT_EQ(count, 7);
+    EXPECT_EQ(reported, vector<int>({3, 3, 3, 4, 5, 6, 7}));
+    EXPECT_EQ(s.range_count_calls, 1u);
+
+    reported.clear();
+    count = tree.range_report(3, 7, [&reported](node *n) { reported.push_back(n->value); }, 2);
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(reported, vector<int>({3, 3}));
+
+    EXPECT_EQ(tree.range_report(11, 20, [](node *) { FAIL(); }), 0);
+    EXPECT_EQ(tree.range_report(7, 3, [](node *) { FAIL(); }), 0);
+    tree.clear();
+}
+
+struct record {
+    int id;
+    string name;
+};
+
+struct id_of {
+    int operator()(const record &r) const noexcept { return r.id; }
+};
+
+TEST(BBTreeTests, KeyOfAndCompare) {
+    statistics_ s;
+    bbalpha<record, no_aggregate, std::less<>, id_of> by_id(0.6, s);
+    bbalpha<int, no_aggregate, std::greater<>> descending(0.6, s);
+    for (int i = 0; i < 200; ++i) {
+        int id = (i * 37) % 101;
+        by_id.insert(record{id, to_string(id)});
+        descending.insert(id);
+    }
+    EXPECT_EQ(by_id.range_count(10, 19), 20);
+    vector<int> ids;
+    by_id.range_report(50, 52, [&ids](auto n) {
+        EXPECT_EQ(n->key(), n->value.id);
+        EXPECT_EQ(n->value.name, to_string(n->value.id));
+        ids.push_back(n->key());
+    });
+    EXPECT_EQ(ids, vector<int>({50, 50, 51, 51, 52, 52}));
+    // Reversed order -- the range goes from the larger key to the smaller one.
+    EXPECT_EQ(descending.range_count(19, 10), 20);
+    EXPECT_EQ(descending.range_count(10, 19), 0);
+    ids.clear();
+    descending.range_report(52, 50, [&ids](auto n) { ids.push_back(n->value); });
+    EXPECT_EQ(ids, vector<int>({52, 52, 51, 51, 50, 50}));
+    by_id.postorder_dfs(by_id.tree, [&by_id](auto n) {
+        EXPECT_GE(by_id.alpha * n->subtree_size, (n->right) ? n->right->subtree_size : 0);
+        EXPECT_GE(by_id.alpha * n->subtree_size, (n->left) ? n->left->subtree_size : 0);
+    });
+}
+
+TEST(BBTreeTests, AdaptiveAlpha) {
+    statistics_ s;
+    bbalpha<int> tree(0.7, s);
+    EXPECT_THROW(tree.adapt_alpha(0.5, 0.9), std::invalid_argument);
+    tree.adapt_alpha(0.55, 0.95);
+    // Inserts only.
+    int v = 0;
+    for (; v < 2000; ++v)
+        tree.insert(v);
+    const double insert_alpha = tree.alpha;
+    EXPECT_GE(insert_alpha, 0.55);
+    EXPECT_LE(insert_alpha, 0.95);
+    // Queries dominate, the next rebuild tightens the balance.
+    for (int i = 0; i < 20000; ++i)
+        tree.range_count(i % 2000, i % 2000 + 10);
+    for (int i = 0; i < 1000 && tree.alpha == insert_alpha; ++i)
+        tree.insert(v++);
+    const double query_alpha = tree.alpha;
+    EXPECT_LT(query_alpha, insert_alpha);
+    EXPECT_GE(query_alpha, 0.55);
+    // Inserts only again, the balance relaxes.
+    for (int i = 0; i < 5000; ++i)
+        tree.insert(v++);
+    EXPECT_GT(tree.alpha, query_alpha);
+    tree.postorder_dfs(tree.tree, [](node *n) {
+        auto val = 1;
+        val += (n->left) ? n->left->subtree_size : 0;
+        val += (n->right) ? n->right->subtree_size : 0;
+        EXPECT_EQ(n->subtree_size, val);
+    });
+}
+
+TEST(BBTreeTests, RangeIterator) {
+    statistics_ s;
+    bbalpha<int> tree(0.65f, s);
+    for (int v = 100; v > 0; --v)
+        tree.insert(v);
+    bbalpha<int>::range_iterator it(tree, 10, 20);
+    int expected = 10;
+    for (node *n = it.next(); n; n = it.next())
+        EXPECT_EQ(n->value, expected++);
+    EXPECT_EQ(expected, 21);
+    EXPECT_EQ(it.next(), nullptr);
+    tree.clear();
+}
+
+TEST(BBTreeTests, RangeAggregate) {
+    statistics_ s;
+    bbalpha<int, sum_aggregate<int>> sum_tree(0.65f, s);
+    bbalpha<int, max_aggregate<int>> max_tree(0.65f, s);
+    vector<int> values;
+    for (int v = 0; v < 200; ++v) {
+        values.push_back((v * 37) % 101);
+        sum_tree.insert(values.back());
+        max_tree.insert(values.back() % 50);
+    }
+    sum_tree.postorder_dfs(sum_tree.tree, [](auto n) {
+        auto val = n->value;
+        val += (n->left) ? n->left->aggregate() : 0;
+        val += (n->right) ? n->right->aggregate() : 0;
+        EXPECT_EQ(n->aggregate(), val);
+    });
+    for (int lo = -5; lo < 110; lo += 7) {
+        for (int hi = lo; hi < 110; hi += 11) {
+            int sum = 0;
+            int max = std::numeric_limits<int>::lowest();
+            for (int v : values) {
+                sum += (lo <= v && v <= hi) ? v : 0;
+                if (lo <= v % 50 && v % 50 <= hi && v % 50 > max)
+                    max = v % 50;
+            }
+            EXPECT_EQ(sum_tree.range_aggregate(lo, hi), sum);
+            EXPECT_EQ(max_tree.range_aggregate(lo, hi), max);
+        }
+    }
+    EXPECT_EQ(sizeof(bbalpha<int>::node), sizeof(bbalpha<int, no_aggregate>::node));
+    EXPECT_LT(sizeof(bbalpha<int>::node), sizeof(bbalpha<int, sum_aggregate<int>>::node));
+}
+
+TEST(BBTreeTests, ParallelRebuild) {
+    statistics_ s1;
+    statistics_ s4;
+    bbalpha<int> sequential(0.55, s1);
+    bbalpha<int> parallel(0.55, s4);
+    parallel.rebuild_threads = 4;
+    // Increasing values make the root unbalanced again and again.
+    for (int v = 0; v < 200000; ++v) {
+        sequential.insert(v);
+        sequential.statistics(true, true);
+        parallel.insert(v);
+        parallel.statistics(true, true);
+    }
+    EXPECT_EQ(s1.insert_visits, s4.insert_visits);
+    EXPECT_EQ(s1.max_insert_visits, s4.max_insert_visits);
+    EXPECT_GT(s4.max_insert_visits, uint_least32_t(bbalpha<int>::parallel_rebuild_cutoff));
+    vector<int> values;
+    parallel.inorder_dfs(parallel.tree, [&values](node *n) {
+        auto val = 1;
+        val += (n->left) ? n->left->subtree_size : 0;
+        val += (n->right) ? n->right->subtree_size : 0;
+        EXPECT_EQ(n->subtree_size, val);
+        EXPECT_EQ(n->parent ? n->parent->subtree_size > n->subtree_size : true, true);
+        values.push_back(n->value);
+    });
+    ASSERT_EQ(values.size(), 200000u);
+    for (int v = 0; v < 200000; ++v)
+        EXPECT_EQ(values[size_t(v)], 199999 - v);
+}
+
+void recursive_orders(node *n, vector<int> &inorder, vector<int> &postorder) {
+    if (!n)
+        return;
+    recursive_orders(n->right, inorder, postorder);
+    inorder.push_back(n->value);
+    recursive_orders(n->left, inorder, postorder);
+    postorder.push_back(n->value);
+}
+
+TEST(BBTreeTests, IterativeTraversals) {
+    statistics_ s;
+    bbalpha<int> tree(0.98, s);
+    unsigned seed = 43;
+    for (int i = 0; i < 5000; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        tree.insert(int(seed % 1000));
+        tree.statistics(true, true);
+    }
+    vector<int> inorder, postorder, expected_inorder, expected_postorder;
+    tree.inorder_dfs(tree.tree, [&inorder](node *n) { inorder.push_back(n->value); });
+    tree.postorder_dfs(tree.tree, [&postorder](node *n) { postorder.push_back(n->value); });
+    recursive_orders(tree.tree, expected_inorder, expected_postorder);
+    EXPECT_EQ(inorder, expected_inorder);
+    EXPECT_EQ(postorder, expected_postorder);
+    EXPECT_TRUE(is_sorted(inorder.rbegin(), inorder.rend()));
+    int_least32_t count = 0;
+    tree.postorder_dfs(tree.tree->left, [&count](node *) { ++count; });
+    EXPECT_EQ(count, (tree.tree->left) ? tree.tree->left->subtree_size : 0);
+    tree.inorder_dfs(static_cast<node *>(nullptr), [](node *) { FAIL(); });
+    tree.postorder_dfs(static_cast<node *>(nullptr), [](node *) { FAIL(); });
+    for (int x = -1; x <= 1001; x += 7)
+        EXPECT_EQ(tree.range_count(x, x + 50), count_if(inorder.begin(), inorder.end(), [x](int v) {
+            return x <= v && v <= x + 50;
+        }));
+}
+
 int main(int argc, char *argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,79 @@
+#include "../src/blocked_keys.h"
+#include "gtest/gtest.h"
+#include <random>
+
+using namespace std;
+using namespace rt;
+
+void test_ranks(const blocked_keys<int> &keys, const vector<int> &values, const int max_value) {
+    EXPECT_EQ(keys.size(), int_least32_t(values.size()));
+    for (int x = -1; x <= max_value + 1; ++x) {
+        EXPECT_EQ(keys.rank(x, false), count_if(values.begin(), values.end(), [x](int v) { return v < x; }));
+        EXPECT_EQ(keys.rank(x, true), count_if(values.begin(), values.end(), [x](int v) { return v <= x; }));
+    }
+    vector<int> sorted(values);
+    sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); ++i)
+        EXPECT_EQ(keys.at(int_least32_t(i)), sorted[i]);
+}
+
+TEST(BlockedKeysTests, BranchlessCount) {
+    vector<int> a{1, 2, 2, 4, 7, 7, 7, 9};
+    for (int x = 0; x <= 10; ++x) {
+        for (size_t n = 0; n <= a.size(); ++n) {
+            auto expected = size_t(lower_bound(a.begin(), a.begin() + n, x) - a.begin());
+            EXPECT_EQ(branchless_count(a.data(), n, [x](int k) { return k < x; }), expected);
+        }
+    }
+}
+
+TEST(BlockedKeysTests, InsertSplitsBlocks) {
+    blocked_keys<int> keys(4);
+    vector<int> values;
+    mt19937 gen(5);
+    uniform_int_distribution<int> value(0, 40);
+    for (int i = 0; i < 300; ++i) {
+        values.push_back(value(gen));
+        keys.insert(values.back());
+        if (i % 50 == 0)
+            test_ranks(keys, values, 40);
+    }
+    test_ranks(keys, values, 40);
+}
+
+TEST(BlockedKeysTests, InsertGrowsLevels) {
+    // Ascending and descending inserts split the last and the first leaf of every level.
+    for (const bool ascending : {true, false}) {
+        blocked_keys<int> keys(3);
+        vector<int> values;
+        for (int i = 0; i < 200; ++i) {
+            values.push_back((ascending) ? i : 199 - i);
+            keys.insert(values.back());
+        }
+        test_ranks(keys, values, 199);
+        EXPECT_GE(keys.search_depth(), 5 * 2u);
+    }
+}
+
+TEST(BlockedKeysTests, AssignThenInsert) {
+    blocked_keys<int> keys(8);
+    vector<int> values;
+    for (int i = 0; i < 100; ++i)
+        values.push_back(i / 3);
+    keys.assign(values.begin(), values.end());
+    test_ranks(keys, values, 34);
+    for (int i = 0; i < 100; ++i) {
+        values.push_back((i * 7) % 35);
+        keys.insert(values.back());
+    }
+    test_ranks(keys, values, 34);
+    // Full blocks and a packed array take little more than the keys.
+    blocked_keys<int> packed(8);
+    packed.assign(values.begin(), values.begin() + 8);
+    EXPECT_EQ(packed.memory_footprint(), sizeof(packed) + 8 * sizeof(int));
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
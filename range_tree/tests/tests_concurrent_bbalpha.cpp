@@ -0,0 +1,104 @@
+#include "../src/concurrent_bbalpha.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <random>
+#include <thread>
+
+using namespace std;
+using namespace rt;
+
+TEST(ConcurrentBBTreeTests, RangeCount) {
+    statistics_ s;
+    concurrent_bbalpha<int> tree(0.65, s);
+    concurrent_bbalpha<int>::reader r(tree);
+    vector<int> values;
+    mt19937 gen(5);
+    uniform_int_distribution<int> value(0, 300);
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(value(gen));
+        tree.insert(values.back());
+    }
+    EXPECT_EQ(tree.elements_count(), 1000);
+    EXPECT_EQ(r.size(), 1000);
+    EXPECT_EQ(s.insert_calls, 1000u);
+    for (int i = 0; i < 200; ++i) {
+        int lo = value(gen), hi = value(gen);
+        EXPECT_EQ(r.range_count(lo, hi), count_if(values.begin(), values.end(), [lo, hi](int v) {
+            return lo <= v && v <= hi;
+        }));
+    }
+    EXPECT_EQ(r.stats.range_count_calls, 200u);
+    // Nobody is reading, so only the versions replaced by the last inserts wait for reclamation.
+    tree.insert(1000);
+    EXPECT_LE(tree.pending_reclamation(), 2u);
+}
+
+TEST(ConcurrentBBTreeTests, ReadersDuringInserts) {
+    statistics_ s;
+    concurrent_bbalpha<int> tree(0.7, s);
+    static constexpr int element_count = 20000;
+    atomic<bool> done{false};
+    vector<thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&tree, &done]() {
+            concurrent_bbalpha<int>::reader r(tree);
+            int_least32_t last = 0;
+            while (!done.load()) {
+                // Values are inserted in increasing order, every version holds a prefix
+                // and the second query sees the same or a later version.
+                auto half = r.range_count(0, element_count / 2 - 1);
+                auto all = r.range_count(0, element_count);
+                EXPECT_GE(all, last);
+                EXPECT_LE(all, element_count);
+                EXPECT_LE(half, std::min(all, element_count / 2));
+                EXPECT_GE(half, std::min(last, element_count / 2));
+                last = all;
+            }
+        });
+    }
+    for (int i = 0; i < element_count; ++i)
+        tree.insert(i);
+    done.store(true);
+    for (auto &t : readers)
+        t.join();
+    concurrent_bbalpha<int>::reader r(tree);
+    EXPECT_EQ(r.range_count(0, element_count), element_count);
+}
+
+TEST(ConcurrentBBTreeTests, RangeTreeReadersDuringInserts) {
+    statistics_ s;
+    concurrent_range_tree<> tree(0.7, s);
+    static constexpr int element_count = 5000;
+    atomic<bool> done{false};
+    vector<thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&tree, &done]() {
+            concurrent_range_tree<>::reader r(tree);
+            int_least32_t last = 0;
+            while (!done.load()) {
+                // Point i is (i, i % 10), later versions hold longer prefixes.
+                auto all = r.range_count(0, 0, element_count, 9);
+                auto low = r.range_count(0, 0, element_count, 4);
+                EXPECT_GE(all, last);
+                EXPECT_LE(all, element_count);
+                EXPECT_GE(low, all / 2);
+                last = all;
+            }
+        });
+    }
+    for (int i = 0; i < element_count; ++i)
+        tree.insert(i, i % 10);
+    done.store(true);
+    for (auto &t : readers)
+        t.join();
+    EXPECT_EQ(tree.elements_count(), element_count);
+    EXPECT_EQ(s.insert_calls, uint_least32_t(element_count));
+    concurrent_range_tree<>::reader r(tree);
+    EXPECT_EQ(r.range_count(100, 3, 199, 3), 10);
+    EXPECT_EQ(r.range_count(0, 0, element_count, 9), element_count);
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,400 @@
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "gtest/gtest.h"
+#include <random>
+
+using namespace std;
+using namespace rt;
+
+template<size_t D>
+int_least32_t brute_force_count(const vector<array<int, D>> &points, const array<int, D> &lo, const array<int, D> &hi) {
+    int_least32_t count = 0;
+    for (const auto &p : points) {
+        bool inside = true;
+        for (size_t i = 0; i < D; ++i)
+            inside = inside && lo[i] <= p[i] && p[i] <= hi[i];
+        count += inside;
+    }
+    return count;
+}
+
+template<size_t D>
+void test_lower_trees(range_tree<D, int> &tree) {
+    tree.postorder_dfs(tree.tree, [&tree](auto n) {
+        auto val = 1;
+        val += (n->left) ? n->left->subtree_size : 0;
+        val += (n->right) ? n->right->subtree_size : 0;
+        EXPECT_EQ(n->subtree_size, val);
+        EXPECT_EQ(n->subtree_size, n->value.lower->elements_count);
+        EXPECT_EQ(n->subtree_size, n->value.lower->tree->subtree_size);
+        EXPECT_GE(tree.alpha * n->subtree_size, (n->right) ? n->right->subtree_size : 0);
+        EXPECT_GE(tree.alpha * n->subtree_size, (n->left) ? n->left->subtree_size : 0);
+    });
+}
+
+TEST(KDRangeTreeTests, RangeCount2D) {
+    statistics_ s;
+    range_tree<2, int> tree(0.65f, s);
+    tree.insert(3, 2);
+    tree.insert(2, 1);
+    tree.insert(1, 3);
+    tree.insert(1, 3);
+    tree.insert(1, 4);
+    tree.insert(1, 2);
+    test_lower_trees(tree);
+    EXPECT_EQ(tree.range_query(0, 0, 3, 3), 5);
+    EXPECT_EQ(tree.range_query(1, 3, 1, 3), 2);
+    EXPECT_EQ(tree.range_query(2, 2, 3, 4), 1);
+    EXPECT_EQ(tree.range_query(4, 0, 10, 10), 0);
+    EXPECT_EQ(s.insert_calls, 6u);
+    EXPECT_EQ(s.range_count_calls, 4u);
+}
+
+TEST(KDRangeTreeTests, RandomInsert3D) {
+    statistics_ s;
+    range_tree<3, int> tree(0.7, s);
+    vector<array<int, 3>> points;
+    mt19937 gen(42);
+    uniform_int_distribution<int> coord(0, 20);
+    for (int i = 0; i < 500; ++i) {
+        points.push_back({coord(gen), coord(gen), coord(gen)});
+        tree.insert(points.back());
+    }
+    test_lower_trees(tree);
+    for (int i = 0; i < 200; ++i) {
+        array<int, 3> lo{coord(gen), coord(gen), coord(gen)};
+        array<int, 3> hi{coord(gen), coord(gen), coord(gen)};
+        EXPECT_EQ(tree.range_query(lo, hi), brute_force_count(points, lo, hi));
+    }
+}
+
+TEST(KDRangeTreeTests, Assign) {
+    statistics_ s;
+    range_tree<2, int> tree(0.6, s);
+    vector<array<int, 2>> points;
+    mt19937 gen(7);
+    uniform_int_distribution<int> coord(0, 50);
+    for (int i = 0; i < 300; ++i)
+        points.push_back({coord(gen), coord(gen)});
+    tree.assign(points);
+    // The assign is an operation of its own, the next insert starts from zero.
+    EXPECT_EQ(s.insert_calls, 1u);
+    EXPECT_EQ(s.last_insert_visits, 0u);
+    EXPECT_GT(s.max_insert_visits, 0u);
+    test_lower_trees(tree);
+    for (int i = 0; i < 50; ++i) {
+        points.push_back({coord(gen), coord(gen)});
+        tree.insert(points.back());
+    }
+    test_lower_trees(tree);
+    for (int i = 0; i < 200; ++i) {
+        array<int, 2> lo{coord(gen), coord(gen)};
+        array<int, 2> hi{coord(gen), coord(gen)};
+        EXPECT_EQ(tree.range_query(lo, hi), brute_force_count(points, lo, hi));
+    }
+}
+
+TEST(KDRangeTreeTests, Build3D) {
+    statistics_ s;
+    range_tree<3, int> tree(0.7, s);
+    vector<array<int, 3>> points;
+    mt19937 gen(11);
+    uniform_int_distribution<int> coord(0, 20);
+    for (int i = 0; i < 600; ++i)
+        points.push_back({coord(gen), coord(gen), coord(gen)});
+    tree.build(points);
+    test_lower_trees(tree);
+    // Lower trees built from merged sequences must be valid search trees.
+    tree.postorder_dfs(tree.tree, [](auto n) {
+        vector<int> keys;
+        n->value.lower->inorder_dfs(n->value.lower->tree, [&keys](auto m) {
+            keys.push_back(m->key());
+        });
+        EXPECT_TRUE(is_sorted(keys.rbegin(), keys.rend()));
+    });
+    for (int i = 0; i < 200; ++i) {
+        array<int, 3> lo{coord(gen), coord(gen), coord(gen)};
+        array<int, 3> hi{coord(gen), coord(gen), coord(gen)};
+        EXPECT_EQ(tree.range_query(lo, hi), brute_force_count(points, lo, hi));
+    }
+}
+
+TEST(KDRangeTreeTests, Compact) {
+    statistics_ s;
+    range_tree<2, int> pointer_tree(0.7, s);
+    range_tree<2, int> compact_tree(0.7, s, 8);
+    range_tree<3, int> compact_3d(0.7, s, 4);
+    vector<array<int, 2>> points;
+    vector<array<int, 3>> points_3d;
+    mt19937 gen(23);
+    uniform_int_distribution<int> coord(0, 40);
+    for (int i = 0; i < 400; ++i) {
+        points.push_back({coord(gen), coord(gen)});
+        points_3d.push_back({coord(gen), coord(gen), coord(gen)});
+    }
+    compact_tree.build(points);
+    compact_3d.build(points_3d);
+    for (int i = 0; i < 300; ++i) {
+        points.push_back({coord(gen), coord(gen)});
+        compact_tree.insert(points.back());
+        points_3d.push_back({coord(gen), coord(gen), coord(gen)});
+        compact_3d.insert(points_3d.back());
+    }
+    for (int i = 0; i < 200; ++i) {
+        array<int, 2> lo{coord(gen), coord(gen)};
+        array<int, 2> hi{coord(gen), coord(gen)};
+        EXPECT_EQ(compact_tree.range_query(lo, hi), brute_force_count(points, lo, hi));
+        array<int, 3> lo_3d{coord(gen), coord(gen), coord(gen)};
+        array<int, 3> hi_3d{coord(gen), coord(gen), coord(gen)};
+        EXPECT_EQ(compact_3d.range_query(lo_3d, hi_3d), brute_force_count(points_3d, lo_3d, hi_3d));
+    }
+    // Per-point overhead of the first level stays, the last level shrinks eight times.
+    points.resize(4096);
+    for (auto &p : points)
+        p = {coord(gen), coord(gen)};
+    pointer_tree.build(points);
+    compact_tree.build(points);
+    EXPECT_LT(2 * compact_tree.memory_footprint(), pointer_tree.memory_footprint());
+    EXPECT_THROW((range_tree<2, int, sum_aggregate<long>>(0.7, s, 8).insert(1, 1)), std::invalid_argument);
+}
+
+TEST(KDRangeTreeTests, RangeAggregate2D) {
+    statistics_ s;
+    range_tree<2, int, sum_aggregate<long>> sum_tree(0.65f, s);
+    range_tree<2, int, min_aggregate<int>> min_tree(0.65f, s);
+    vector<pair<array<int, 2>, int>> points;
+    mt19937 gen(3);
+    uniform_int_distribution<int> coord(0, 30);
+    uniform_int_distribution<int> weight(-100, 100);
+    for (int i = 0; i < 400; ++i) {
+        points.push_back({{coord(gen), coord(gen)}, weight(gen)});
+        sum_tree.insert(points.back().first, points.back().second);
+        min_tree.insert(points.back().first[0], points.back().first[1], points.back().second);
+    }
+    for (int i = 0; i < 200; ++i) {
+        int x1 = coord(gen), y1 = coord(gen), x2 = coord(gen), y2 = coord(gen);
+        long sum = 0;
+        int min = std::numeric_limits<int>::max();
+        for (const auto &p : points) {
+            if (x1 <= p.first[0] && p.first[0] <= x2 && y1 <= p.first[1] && p.first[1] <= y2) {
+                sum += p.second;
+                min = std::min(min, p.second);
+            }
+        }
+        EXPECT_EQ(sum_tree.range_aggregate(x1, y1, x2, y2), sum);
+        EXPECT_EQ(min_tree.range_aggregate(x1, y1, x2, y2), min);
+    }
+    EXPECT_EQ(sizeof(range_tree_leaf<int, no_aggregate>), sizeof(int));
+}
+
+template<size_t D>
+vector<array<int, D>> brute_force_report(const vector<array<int, D>> &points, const array<int, D> &lo,
+                                         const array<int, D> &hi) {
+    vector<array<int, D>> inside;
+    for (const auto &p : points) {
+        if (brute_force_count(vector<array<int, D>>{p}, lo, hi))
+            inside.push_back(p);
+    }
+    sort(inside.begin(), inside.end());
+    return inside;
+}
+
+template<size_t D>
+void test_range_report(range_tree<D, int> &tree, const vector<array<int, D>> &points, mt19937 &gen, const int max) {
+    uniform_int_distribution<int> coord(0, max);
+    for (int i = 0; i < 200; ++i) {
+        array<int, D> lo, hi;
+        for (size_t d = 0; d < D; ++d) {
+            lo[d] = coord(gen);
+            hi[d] = coord(gen);
+        }
+        vector<array<int, D>> reported;
+        const auto count = tree.range_report(lo, hi, [&reported](const array<int, D> &p) { reported.push_back(p); });
+        sort(reported.begin(), reported.end());
+        EXPECT_EQ(reported, brute_force_report(points, lo, hi));
+        EXPECT_EQ(count, int_least32_t(reported.size()));
+        // A limited report takes a prefix of the same enumeration.
+        vector<array<int, D>> first;
+        const int_least32_t limit = count / 2;
+        EXPECT_EQ(tree.range_report(lo, hi, [&first](const array<int, D> &p) { first.push_back(p); }, limit), limit);
+        for (const auto &p : first)
+            EXPECT_TRUE(binary_search(reported.begin(), reported.end(), p));
+    }
+}
+
+TEST(KDRangeTreeTests, RangeReport) {
+    statistics_ s;
+    range_tree<2, int> tree(0.7, s);
+    range_tree<2, int> compact_tree(0.7, s, 4);
+    range_tree<3, int> tree_3d(0.7, s);
+    range_tree<3, int> compact_3d(0.7, s, 4);
+    vector<array<int, 2>> points;
+    vector<array<int, 3>> points_3d;
+    mt19937 gen(29);
+    uniform_int_distribution<int> coord(0, 50);
+    for (int i = 0; i < 300; ++i)
+        points.push_back({coord(gen), coord(gen)});
+    tree.build(points);
+    compact_tree.build(points);
+    for (int i = 0; i < 600; ++i) {
+        points.push_back({coord(gen), coord(gen)});
+        tree.insert(points.back());
+        compact_tree.insert(points.back());
+        points_3d.push_back({coord(gen), coord(gen), coord(gen)});
+        tree_3d.insert(points_3d.back());
+        compact_3d.insert(points_3d.back());
+    }
+    test_range_report(tree, points, gen, 50);
+    test_range_report(compact_tree, points, gen, 50);
+    test_range_report(tree_3d, points_3d, gen, 50);
+    test_range_report(compact_3d, points_3d, gen, 50);
+    // The iterator is lazy, it is left after the first point.
+    range_tree<2, int>::report_iterator it(tree, array<int, 2>{0, 0}, array<int, 2>{50, 50});
+    ASSERT_NE(it.next(), nullptr);
+    int_least32_t reported = 0;
+    EXPECT_EQ(tree.range_report(10, 10, 20, 20, [&reported](const array<int, 2> &p) {
+        EXPECT_TRUE(10 <= p[0] && p[0] <= 20 && 10 <= p[1] && p[1] <= 20);
+        ++reported;
+    }), brute_force_count(points, {10, 10}, {20, 20}));
+    EXPECT_EQ(reported, brute_force_count(points, {10, 10}, {20, 20}));
+}
+
+TEST(KDRangeTreeTests, RangeQueryBatch) {
+    statistics_ s;
+    range_tree<2, int> tree(0.7, s);
+    mt19937 gen(11);
+    uniform_int_distribution<int> coord(0, 1000);
+    for (int i = 0; i < 2000; ++i)
+        tree.insert(coord(gen), coord(gen));
+    vector<range_tree<2, int>::rect> queries;
+    for (int i = 0; i < 1000; ++i)
+        queries.push_back({{coord(gen), coord(gen)}, {coord(gen), coord(gen)}});
+    for (unsigned threads : {1u, 3u, 8u}) {
+        vector<int_least32_t> counts;
+        tree.range_query_batch(queries, counts, threads);
+        ASSERT_EQ(counts.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i)
+            EXPECT_EQ(counts[i], tree.range_query(queries[i].lo, queries[i].hi));
+    }
+}
+
+TEST(KDRangeTreeTests, ParallelRebuild) {
+    statistics_ s1;
+    statistics_ s4;
+    range_tree<2, int> sequential(0.6, s1);
+    range_tree<2, int> parallel(0.6, s4);
+    parallel.rebuild_threads = 4;
+    vector<array<int, 2>> points;
+    mt19937 gen(17);
+    uniform_int_distribution<int> coord(0, 1 << 20);
+    for (int i = 0; i < 70000; ++i)
+        points.push_back({coord(gen), coord(gen)});
+    sequential.assign(points);
+    parallel.assign(points);
+    for (int i = 0; i < 2000; ++i) {
+        // Increasing first coordinate keeps the x-tree rebuilding its right spine.
+        const int y = coord(gen);
+        sequential.insert(1 << 21 | i, y);
+        parallel.insert(1 << 21 | i, y);
+    }
+    EXPECT_EQ(s1.insert_visits, s4.insert_visits);
+    EXPECT_EQ(s1.max_insert_visits, s4.max_insert_visits);
+    test_lower_trees(parallel);
+    for (int i = 0; i < 100; ++i) {
+        array<int, 2> lo{coord(gen), coord(gen)};
+        array<int, 2> hi{lo[0] + coord(gen) * 2, lo[1] + coord(gen)};
+        EXPECT_EQ(parallel.range_query(lo, hi), sequential.range_query(lo, hi));
+    }
+}
+
+TEST(KDRangeTreeTests, Layered) {
+    statistics_ s_dynamic;
+    statistics_ s_layered;
+    range_tree<2, int> dynamic(0.7, s_dynamic);
+    range_tree<2, int> layered(0.7, s_layered);
+    layered.layered = true;
+    vector<array<int, 2>> points;
+    mt19937 gen(23);
+    uniform_int_distribution<int> coord(0, 3000);
+    for (int i = 0; i < 5000; ++i)
+        points.push_back({coord(gen), coord(gen)});
+    dynamic.assign(points);
+    layered.assign(points);
+    const auto compare = [&](const int queries) {
+        for (int i = 0; i < queries; ++i) {
+            array<int, 2> lo{coord(gen), coord(gen)};
+            array<int, 2> hi{lo[0] + coord(gen) / 2, lo[1] + coord(gen) / 2};
+            const int_least32_t expected = brute_force_count(points, lo, hi);
+            EXPECT_EQ(layered.range_query(lo, hi), expected);
+            EXPECT_EQ(dynamic.range_query(lo, hi), expected);
+        }
+    };
+    compare(200);
+    // Straight after assign the whole query is one layered count.
+    EXPECT_LT(s_layered.range_count_visits, s_dynamic.range_count_visits);
+    for (int round = 0; round < 10; ++round) {
+        // Random inserts leave paths counted by lower trees, increasing first coordinates rebuild the right spine.
+        for (int i = 0; i < 300; ++i) {
+            points.push_back({(i % 2) ? coord(gen) : 3000 + round * 300 + i, coord(gen)});
+            dynamic.insert(points.back());
+            layered.insert(points.back());
+        }
+        test_lower_trees(layered);
+        compare(100);
+    }
+    int_least32_t clean = 0;
+    layered.postorder_dfs(layered.tree, [&clean](auto n) {
+        if (n->value.layers) {
+            // The subtree is the window of the counter between its leftmost and rightmost node.
+            ++clean;
+            auto first = n;
+            auto last = n;
+            while (first->left)
+                first = first->left;
+            while (last->right)
+                last = last->right;
+            const auto offset = size_t(n->value.layers_offset);
+            EXPECT_EQ(n->value.layers->point(offset)[0], first->value.point[0]);
+            EXPECT_EQ(n->value.layers->point(offset + size_t(n->subtree_size) - 1)[0], last->value.point[0]);
+        }
+    });
+    EXPECT_GT(clean, 0);
+    EXPECT_LT(clean, layered.elements_count);
+    vector<range_tree<2, int>::rect> queries;
+    for (int i = 0; i < 300; ++i) {
+        array<int, 2> lo{coord(gen), coord(gen)};
+        queries.push_back({lo, {lo[0] + coord(gen), lo[1] + coord(gen)}});
+    }
+    vector<int_least32_t> layered_counts;
+    vector<int_least32_t> dynamic_counts;
+    layered.range_query_batch(queries, layered_counts, 4);
+    dynamic.range_query_batch(queries, dynamic_counts, 4);
+    EXPECT_EQ(layered_counts, dynamic_counts);
+}
+
+TEST(KDRangeTreeTests, Layered3D) {
+    statistics_ s;
+    range_tree<3, int> tree(0.7, s);
+    tree.layered = true;
+    vector<array<int, 3>> points;
+    mt19937 gen(29);
+    uniform_int_distribution<int> coord(0, 30);
+    for (int i = 0; i < 800; ++i)
+        points.push_back({coord(gen), coord(gen), coord(gen)});
+    tree.assign(points);
+    for (int i = 0; i < 400; ++i) {
+        points.push_back({coord(gen), coord(gen), coord(gen)});
+        tree.insert(points.back());
+    }
+    test_lower_trees(tree);
+    for (int i = 0; i < 200; ++i) {
+        array<int, 3> lo{coord(gen), coord(gen), coord(gen)};
+        array<int, 3> hi{coord(gen), coord(gen), coord(gen)};
+        EXPECT_EQ(tree.range_query(lo, hi), brute_force_count(points, lo, hi));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
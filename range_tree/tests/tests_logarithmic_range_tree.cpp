@@ -0,0 +1,114 @@
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "../src/logarithmic_range_tree.h"
+#include "gtest/gtest.h"
+#include <random>
+
+using namespace std;
+using namespace rt;
+
+TEST(LogarithmicRangeTreeTests, Counter) {
+    vector<layered_range_counter<>::point_type> points;
+    for (int_least32_t x = 0; x < 100; ++x)
+        points.push_back({x % 10, x});
+    layered_range_counter<> counter(points);
+    uint_least32_t visits = 0;
+    EXPECT_EQ(counter.size(), 100u);
+    EXPECT_EQ(counter.range_query(0, 0, 9, 99, visits), 100);
+    EXPECT_EQ(counter.range_query(3, 0, 3, 99, visits), 10);
+    EXPECT_EQ(counter.range_query(3, 50, 4, 99, visits), 10);
+    EXPECT_EQ(counter.range_query(4, 50, 3, 99, visits), 0);
+    EXPECT_GT(visits, 0u);
+}
+
+TEST(LogarithmicRangeTreeTests, CounterCascades) {
+    vector<layered_range_counter<>::point_type> points;
+    mt19937 gen(43);
+    uniform_int_distribution<int_least32_t> coord(-500, 500);
+    for (int i = 0; i < 5000; ++i)
+        points.push_back({coord(gen), coord(gen) / 8});
+    layered_range_counter<> counter(points);
+    for (int i = 0; i < 300; ++i) {
+        int_least32_t x1 = coord(gen), y1 = coord(gen) / 8, x2 = coord(gen), y2 = coord(gen) / 8;
+        int_least32_t expected = 0;
+        for (const auto &p : points)
+            expected += (x1 <= p[0] && p[0] <= x2 && y1 <= p[1] && p[1] <= y2) ? 1 : 0;
+        uint_least32_t visits = 0;
+        EXPECT_EQ(counter.range_query(x1, y1, x2, y2, visits), expected);
+        // Two paths of nodes and the scanned ends, not one node per level piece.
+        EXPECT_LE(visits, 4 * counter.levels() + 4 * (1u << layered_min_level));
+    }
+}
+
+TEST(LogarithmicRangeTreeTests, BuilderSteps) {
+    vector<layered_range_counter<>::point_type> a, b;
+    mt19937 gen(41);
+    uniform_int_distribution<int_least32_t> coord(-100, 100);
+    for (int i = 0; i < 300; ++i)
+        a.push_back({coord(gen), coord(gen)});
+    for (int i = 0; i < 200; ++i)
+        b.push_back({coord(gen), coord(gen)});
+    layered_range_counter<> first(a), second(b);
+    a.insert(a.end(), b.begin(), b.end());
+    layered_range_counter<> reference(a);
+
+    layered_range_counter<>::builder builder(first, second);
+    size_t work = 0;
+    while (!builder.done())
+        work += builder.step(7);
+    EXPECT_EQ(work, builder.total_work());
+    layered_range_counter<> merged = builder.result();
+    ASSERT_EQ(merged.size(), 500u);
+    for (size_t i = 0; i < merged.size(); ++i)
+        EXPECT_EQ(merged.point(i), reference.point(i));
+    uint_least32_t visits = 0;
+    for (int i = 0; i < 200; ++i) {
+        int_least32_t x1 = coord(gen), y1 = coord(gen), x2 = coord(gen), y2 = coord(gen);
+        EXPECT_EQ(merged.range_query(x1, y1, x2, y2, visits), reference.range_query(x1, y1, x2, y2, visits));
+    }
+}
+
+TEST(LogarithmicRangeTreeTests, SameAsRangeTree) {
+    for (bool deamortized : {false, true}) {
+        statistics_ s, t;
+        range_tree<2> reference(0.7, s);
+        logarithmic_range_tree<> tree(t, deamortized, 16);
+        mt19937 gen(41);
+        uniform_int_distribution<int_least32_t> coord(-300, 300);
+        for (int i = 0; i < 5000; ++i) {
+            int_least32_t x = coord(gen), y = coord(gen);
+            reference.insert(x, y);
+            tree.insert(x, y);
+            if (i % 97 == 0) {
+                int_least32_t x1 = coord(gen), y1 = coord(gen), x2 = coord(gen), y2 = coord(gen);
+                EXPECT_EQ(tree.range_query(x1, y1, x2, y2), reference.range_query(x1, y1, x2, y2));
+            }
+        }
+        EXPECT_EQ(tree.size(), 5000u);
+        EXPECT_EQ(tree.range_query(-300, -300, 300, 300), 5000);
+    }
+}
+
+TEST(LogarithmicRangeTreeTests, DeamortizedWorstCase) {
+    statistics_ s, t;
+    logarithmic_range_tree<> amortized(s);
+    logarithmic_range_tree<> deamortized(t, true);
+    mt19937 gen(41);
+    uniform_int_distribution<int_least32_t> coord(-1000000, 1000000);
+    const size_t n = 1 << 16;
+    for (size_t i = 0; i < n; ++i) {
+        int_least32_t x = coord(gen), y = coord(gen);
+        amortized.insert(x, y);
+        deamortized.insert(x, y);
+    }
+    EXPECT_EQ(amortized.range_query(-1000000, -1000000, 1000000, 1000000), int_least32_t(n));
+    EXPECT_EQ(deamortized.range_query(-1000000, -1000000, 1000000, 1000000), int_least32_t(n));
+    // The last amortized insert merged all points.
+    EXPECT_GE(s.max_insert_visits, n);
+    EXPECT_LT(8 * t.max_insert_visits, s.max_insert_visits);
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
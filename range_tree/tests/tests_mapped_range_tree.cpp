@@ -0,0 +1,120 @@
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "../src/mapped_range_tree.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <fstream>
+
+using namespace std;
+using namespace rt;
+
+static string temporary_path(const string &name) {
+    return ::testing::TempDir() + "mapped_range_tree_" + name;
+}
+
+TEST(MappedRangeTreeTests, Empty) {
+    const string path = temporary_path("empty");
+    mapped_range_tree<>::write(path, {});
+    mapped_range_tree<> tree(path);
+    EXPECT_EQ(tree.size(), 0u);
+    EXPECT_EQ(tree.range_query(-10, -10, 10, 10), 0);
+    tree.insert(1, 1);
+    EXPECT_EQ(tree.range_query(-10, -10, 10, 10), 1);
+    EXPECT_EQ(tree.range_query(2, -10, 10, 10), 0);
+}
+
+TEST(MappedRangeTreeTests, NotATree) {
+    const string path = temporary_path("garbage");
+    {
+        ofstream ofs(path, ios::binary);
+        ofs << string(8192, 'x');
+    }
+    EXPECT_THROW(mapped_range_tree<> tree(path), runtime_error);
+    EXPECT_THROW(mapped_range_tree<> tree(temporary_path("missing")), system_error);
+}
+
+TEST(MappedRangeTreeTests, SameAsRangeTree) {
+    const string path = temporary_path("random");
+    statistics_ s;
+    range_tree<2> reference(0.7, s);
+    mt19937 gen(40);
+    uniform_int_distribution<int_least32_t> coord(-500, 500);
+    vector<mapped_range_tree<>::point_type> points(20000);
+    for (auto &p : points) {
+        p = {coord(gen), coord(gen)};
+        reference.insert(p);
+    }
+    mapped_range_tree<>::write(path, points);
+
+    auto check = [&](mapped_range_tree<> &tree) {
+        for (int i = 0; i < 300; ++i) {
+            int_least32_t x1 = coord(gen), y1 = coord(gen), x2 = coord(gen), y2 = coord(gen);
+            EXPECT_EQ(tree.range_query(x1, y1, x2, y2), reference.range_query(x1, y1, x2, y2));
+        }
+        EXPECT_EQ(tree.range_query(-500, -500, 500, 500), int_least32_t(tree.size()));
+    };
+    {
+        mapped_range_tree<> tree(path);
+        EXPECT_EQ(tree.size(), points.size());
+        // Three coordinates and bridges of two bits per level of a point.
+        EXPECT_LT(tree.mapped_bytes(), 20 * points.size());
+        check(tree);
+        for (int i = 0; i < 1000; ++i) {
+            int_least32_t x = coord(gen), y = coord(gen);
+            tree.insert(x, y);
+            reference.insert(x, y);
+        }
+        EXPECT_EQ(tree.pending(), 1000u);
+        check(tree);
+    }
+    {
+        // The log is replayed on reopening.
+        mapped_range_tree<> tree(path);
+        EXPECT_EQ(tree.pending(), 1000u);
+        check(tree);
+        tree.snapshot();
+        EXPECT_EQ(tree.pending(), 0u);
+        EXPECT_EQ(tree.size(), 21000u);
+        check(tree);
+        tree.insert(0, 0);
+        reference.insert(0, 0);
+        check(tree);
+    }
+    {
+        mapped_range_tree<> tree(path);
+        EXPECT_EQ(tree.size(), 21001u);
+        EXPECT_EQ(tree.pending(), 1u);
+        check(tree);
+    }
+}
+
+TEST(MappedRangeTreeTests, SnapshotSameAsWrite) {
+    const string merged = temporary_path("merged");
+    const string written = temporary_path("written");
+    mt19937 gen(41);
+    uniform_int_distribution<int_least32_t> coord(-100, 100);
+    vector<mapped_range_tree<>::point_type> points(5000);
+    for (auto &p : points)
+        p = {coord(gen), coord(gen)};
+    mapped_range_tree<>::write(merged, vector<mapped_range_tree<>::point_type>(points.begin(), points.begin() + 3000));
+    {
+        mapped_range_tree<> tree(merged);
+        for (size_t i = 3000; i < points.size(); ++i)
+            tree.insert(points[i][0], points[i][1]);
+        tree.snapshot();
+    }
+    mapped_range_tree<>::write(written, points);
+    auto contents = [](const string &path) {
+        ifstream ifs(path, ios::binary);
+        return string(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+    };
+    // The files differ only in the log generation within the header page.
+    const string a = contents(merged), b = contents(written);
+    ASSERT_EQ(a.size(), b.size());
+    EXPECT_TRUE(a.compare(4096, string::npos, b, 4096, string::npos) == 0);
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,97 @@
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "../src/offline_range_count.h"
+#include "gtest/gtest.h"
+#include <random>
+
+using namespace std;
+using namespace rt;
+
+TEST(OfflineRangeCountTests, Fenwick) {
+    fenwick_tree tree(10);
+    tree.add(0, 1);
+    tree.add(3, 2);
+    tree.add(9, 5);
+    EXPECT_EQ(tree.prefix(0), 0);
+    EXPECT_EQ(tree.prefix(1), 1);
+    EXPECT_EQ(tree.prefix(4), 3);
+    EXPECT_EQ(tree.prefix(9), 3);
+    EXPECT_EQ(tree.prefix(10), 8);
+}
+
+TEST(OfflineRangeCountTests, Boundaries) {
+    offline_range_count<> engine;
+    engine.add_point(1, 1);
+    engine.add_point(1, 3);
+    engine.add_point(2, 2);
+    engine.add_point(2, 2);
+    engine.add_query(1, 1, 2, 3);
+    engine.add_query(2, 2, 2, 2);
+    engine.add_query(1, 2, 1, 3);
+    engine.add_query(3, 0, 1, 5);
+    engine.add_query(0, 4, 5, 9);
+    EXPECT_EQ(engine.run(), vector<int_least32_t>({4, 2, 1, 0, 0}));
+}
+
+TEST(OfflineRangeCountTests, SameAsRangeTree) {
+    statistics_ s;
+    range_tree<2> tree(0.7, s);
+    offline_range_count<> engine;
+    mt19937 gen(29);
+    uniform_int_distribution<int_least32_t> coord(-50, 50);
+    for (int i = 0; i < 1000; ++i) {
+        int_least32_t x = coord(gen), y = coord(gen);
+        tree.insert(x, y);
+        engine.add_point(x, y);
+    }
+    for (int i = 0; i < 500; ++i)
+        engine.add_query(coord(gen), coord(gen), coord(gen), coord(gen));
+    auto counts = engine.run();
+    ASSERT_EQ(counts.size(), 500u);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        const auto &q = engine.queries()[i];
+        EXPECT_EQ(counts[i], tree.range_query(q.lo, q.hi));
+    }
+}
+
+TEST(OfflineRangeCountTests, CountsBeforeLaterInserts) {
+    offline_range_count<> engine;
+    engine.add_query(0, 0, 9, 9);
+    engine.add_point(1, 1);
+    engine.add_query(0, 0, 9, 9);
+    engine.add_point(1, 1);
+    engine.add_point(5, 5);
+    engine.add_query(1, 1, 1, 1);
+    engine.add_query(2, 0, 9, 9);
+    engine.add_point(1, 2);
+    engine.add_query(1, 1, 1, 2);
+    EXPECT_EQ(engine.run(), vector<int_least32_t>({0, 1, 2, 1, 3}));
+    EXPECT_EQ(engine.times(), vector<size_t>({0, 1, 3, 3, 4}));
+}
+
+TEST(OfflineRangeCountTests, InterleavedSameAsRangeTree) {
+    statistics_ s;
+    range_tree<2> tree(0.7, s);
+    offline_range_count<> engine;
+    vector<int_least32_t> expected;
+    mt19937 gen(31);
+    uniform_int_distribution<int_least32_t> coord(-50, 50);
+    uniform_int_distribution<int> operation(0, 2);
+    for (int i = 0; i < 3000; ++i) {
+        int_least32_t x1 = coord(gen), y1 = coord(gen);
+        if (operation(gen) != 0) {
+            tree.insert(x1, y1);
+            engine.add_point(x1, y1);
+            continue;
+        }
+        int_least32_t x2 = coord(gen), y2 = coord(gen);
+        expected.push_back(tree.range_query(x1, y1, x2, y2));
+        engine.add_query(x1, y1, x2, y2);
+    }
+    EXPECT_EQ(engine.run(), expected);
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,103 @@
+#include "../src/persistent_bbalpha.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <unordered_set>
+
+using namespace std;
+using namespace rt;
+
+using tree_t = persistent_bbalpha<int>;
+
+void collect_nodes(const tree_t::node *n, unordered_set<const tree_t::node *> &nodes) {
+    if (!n || !nodes.insert(n).second)
+        return;
+    collect_nodes(n->right, nodes);
+    collect_nodes(n->left, nodes);
+}
+
+TEST(PersistentBBTreeTests, Versions) {
+    statistics_ s;
+    vector<tree_t> versions{tree_t(0.65, s)};
+    vector<int> values;
+    mt19937 gen(13);
+    uniform_int_distribution<int> value(0, 100);
+    for (int i = 0; i < 500; ++i) {
+        values.push_back(value(gen));
+        versions.push_back(versions.back().insert(values.back()));
+    }
+    for (size_t v = 0; v < versions.size(); v += 25) {
+        EXPECT_EQ(versions[v].elements_count(), int_least32_t(v));
+        for (int i = 0; i < 20; ++i) {
+            int lo = value(gen), hi = value(gen);
+            EXPECT_EQ(versions[v].range_count(lo, hi), count_if(values.begin(), values.begin() + v, [lo, hi](int x) {
+                return lo <= x && x <= hi;
+            }));
+        }
+    }
+    // Structure is shared, all versions together take far less than a full copy each.
+    unordered_set<const tree_t::node *> nodes;
+    for (const auto &v : versions)
+        collect_nodes(v.root(), nodes);
+    EXPECT_LT(nodes.size(), 500u * 40);
+}
+
+TEST(PersistentBBTreeTests, Balance) {
+    statistics_ s;
+    tree_t tree(0.7, s);
+    for (int i = 0; i < 1000; ++i)
+        tree = tree.insert(i % 7);
+    unordered_set<const tree_t::node *> nodes;
+    collect_nodes(tree.root(), nodes);
+    EXPECT_EQ(nodes.size(), 1000u);
+    for (auto n : nodes) {
+        auto val = 1;
+        val += (n->left) ? n->left->subtree_size : 0;
+        val += (n->right) ? n->right->subtree_size : 0;
+        EXPECT_EQ(n->subtree_size, val);
+        EXPECT_LE(n->value, (n->right) ? n->right->value : std::numeric_limits<int>::max());
+        EXPECT_GE(n->value, (n->left) ? n->left->value : 0);
+        EXPECT_GE(tree.alpha * n->subtree_size, (n->right) ? n->right->subtree_size : 0);
+        EXPECT_GE(tree.alpha * n->subtree_size, (n->left) ? n->left->subtree_size : 0);
+    }
+}
+
+TEST(PersistentBBTreeTests, ReleaseInAnyOrder) {
+    statistics_ s;
+    vector<tree_t> versions{tree_t(0.6, s)};
+    for (int i = 0; i < 300; ++i)
+        versions.push_back(versions.back().insert((i * 31) % 97));
+    tree_t kept = versions[150];
+    shuffle(versions.begin(), versions.end(), mt19937(1));
+    versions.clear();
+    EXPECT_EQ(kept.elements_count(), 150);
+    EXPECT_EQ(kept.range_count(0, 96), 150);
+}
+
+TEST(PersistentBBTreeTests, RangeTreeVersions) {
+    statistics_ s;
+    vector<persistent_range_tree<>> versions{persistent_range_tree<>(0.7, s)};
+    vector<persistent_range_tree<>::point_type> points;
+    mt19937 gen(17);
+    uniform_int_distribution<int_least32_t> coord(-50, 50);
+    for (int i = 0; i < 800; ++i) {
+        points.push_back({coord(gen), coord(gen)});
+        versions.push_back(versions.back().insert(points.back()[0], points.back()[1]));
+    }
+    for (size_t v = 0; v < versions.size(); v += 40) {
+        EXPECT_EQ(versions[v].elements_count(), int_least32_t(v));
+        for (int i = 0; i < 20; ++i) {
+            int_least32_t x1 = coord(gen), y1 = coord(gen), x2 = coord(gen), y2 = coord(gen);
+            EXPECT_EQ(versions[v].range_count(x1, y1, x2, y2),
+                      count_if(points.begin(), points.begin() + v, [=](const persistent_range_tree<>::point_type &p) {
+                          return x1 <= p[0] && p[0] <= x2 && y1 <= p[1] && p[1] <= y2;
+                      }));
+        }
+    }
+    versions.erase(versions.begin() + 1, versions.end() - 1);
+    EXPECT_EQ(versions.back().range_count(-50, -50, 50, 50), 800);
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
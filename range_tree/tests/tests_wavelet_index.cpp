@@ -0,0 +1,96 @@
+#include "../src/wavelet_index.h"
+#include "gtest/gtest.h"
+#include <random>
+
+using namespace std;
+using namespace rt;
+
+TEST(WaveletIndexTests, RankSelect) {
+    for (size_t n : {1, 63, 64, 255, 256, 1000}) {
+        rank_bitvector bits(n);
+        vector<size_t> ones, zeros;
+        mt19937 gen(static_cast<uint32_t>(n));
+        for (size_t i = 0; i < n; ++i) {
+            if (gen() % 3 == 0) {
+                bits.set(i);
+                ones.push_back(i);
+            } else {
+                zeros.push_back(i);
+            }
+        }
+        bits.build();
+        EXPECT_EQ(bits.ones(), ones.size());
+        for (size_t i = 0; i <= n; ++i) {
+            auto expected = size_t(lower_bound(ones.begin(), ones.end(), i) - ones.begin());
+            EXPECT_EQ(bits.rank1(i), expected);
+            EXPECT_EQ(bits.rank0(i), i - expected);
+        }
+        for (size_t k = 0; k < ones.size(); ++k)
+            EXPECT_EQ(bits.select1(k), ones[k]);
+        for (size_t k = 0; k < zeros.size(); ++k)
+            EXPECT_EQ(bits.select0(k), zeros[k]);
+    }
+}
+
+template<typename Coord>
+void test_elias_fano(vector<Coord> values, const vector<Coord> &probes) {
+    sort(values.begin(), values.end());
+    elias_fano<Coord> ef(values);
+    ASSERT_EQ(ef.size(), values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+        EXPECT_EQ(ef[i], values[i]);
+    for (const Coord x : probes) {
+        EXPECT_EQ(ef.lower_bound(x), size_t(lower_bound(values.begin(), values.end(), x) - values.begin()));
+        EXPECT_EQ(ef.upper_bound(x), size_t(upper_bound(values.begin(), values.end(), x) - values.begin()));
+    }
+}
+
+TEST(WaveletIndexTests, EliasFano) {
+    mt19937 gen(37);
+    for (int span : {0, 1, 10, 1000, 1 << 30}) {
+        uniform_int_distribution<int> coord(-span / 2, span - span / 2);
+        vector<int> values, probes;
+        for (int i = 0; i < 500; ++i) {
+            values.push_back(coord(gen));
+            probes.push_back(coord(gen));
+        }
+        for (int v : {numeric_limits<int>::min(), -span / 2 - 1, -span / 2, span - span / 2, span - span / 2 + 1,
+                      numeric_limits<int>::max()})
+            probes.push_back(v);
+        test_elias_fano(values, probes);
+    }
+    test_elias_fano<int64_t>({numeric_limits<int64_t>::min(), -1, 0, 0, numeric_limits<int64_t>::max()},
+                             {numeric_limits<int64_t>::min(), -2, -1, 0, 1, numeric_limits<int64_t>::max()});
+    test_elias_fano<int>({}, {-1, 0, 1});
+    // Dense sorted x take a few bits each.
+    vector<int> dense(10000);
+    for (size_t i = 0; i < dense.size(); ++i)
+        dense[i] = int(i / 2) * 3 - 5000;
+    EXPECT_LT(elias_fano<int>(dense).memory_footprint(), dense.size());
+}
+
+TEST(WaveletIndexTests, RangeQuery) {
+    for (int max : {0, 1, 7, 8, 100}) {
+        vector<array<int, 2>> points;
+        mt19937 gen(31);
+        uniform_int_distribution<int> coord(-max, max);
+        for (int i = 0; i < 700; ++i)
+            points.push_back({coord(gen), coord(gen)});
+        wavelet_index<int> index(points);
+        EXPECT_EQ(index.size(), points.size());
+        for (int i = 0; i < 300; ++i) {
+            int x1 = coord(gen) - 1, y1 = coord(gen) - 1, x2 = coord(gen) + 1, y2 = coord(gen) + 1;
+            auto expected = count_if(points.begin(), points.end(), [=](const array<int, 2> &p) {
+                return x1 <= p[0] && p[0] <= x2 && y1 <= p[1] && p[1] <= y2;
+            });
+            EXPECT_EQ(index.range_query(x1, y1, x2, y2), expected);
+        }
+    }
+    wavelet_index<int> empty({});
+    EXPECT_EQ(empty.range_query(0, 0, 10, 10), 0);
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+#include "../src/bbalpha_tree.h"
+#include "../src/kd_range_tree.h"
+#include "../src/zorder_index.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <limits>
+
+using namespace std;
+using namespace rt;
+
+TEST(ZOrderIndexTests, Morton) {
+    EXPECT_EQ(morton_encode(0, 0), 0u);
+    EXPECT_EQ(morton_encode(1, 0), 1u);
+    EXPECT_EQ(morton_encode(0, 1), 2u);
+    EXPECT_EQ(morton_encode(3, 5), 0x27u);
+    EXPECT_EQ(morton_encode(0xFFFFFFFFu, 0xFFFFFFFFu), ~uint64_t(0));
+    EXPECT_EQ(morton_compact(morton_encode(123456789u, 987654321u)), 123456789u);
+    EXPECT_EQ(morton_compact(morton_encode(123456789u, 987654321u) >> 1), 987654321u);
+}
+
+TEST(ZOrderIndexTests, BigminLitmax) {
+    // Every key outside a box on a 16x16 grid against a scan of all keys.
+    for (uint32_t x1 = 0; x1 < 16; x1 += 3) {
+        for (uint32_t y1 = 0; y1 < 16; y1 += 5) {
+            const uint32_t x2 = x1 + 5, y2 = y1 + 2;
+            const uint64_t zmin = morton_encode(x1, y1), zmax = morton_encode(x2, y2);
+            auto inside = [&](uint64_t z) {
+                const uint32_t x = morton_compact(z), y = morton_compact(z >> 1);
+                return x1 <= x && x <= x2 && y1 <= y && y <= y2;
+            };
+            for (uint64_t z = zmin + 1; z < zmax; ++z) {
+                if (inside(z))
+                    continue;
+                uint64_t litmax, bigmin, expected_litmax = z, expected_bigmin = z;
+                morton_split(z, zmin, zmax, litmax, bigmin);
+                while (!inside(expected_litmax))
+                    --expected_litmax;
+                while (!inside(expected_bigmin))
+                    ++expected_bigmin;
+                EXPECT_EQ(litmax, expected_litmax);
+                EXPECT_EQ(bigmin, expected_bigmin);
+            }
+        }
+    }
+}
+
+TEST(ZOrderIndexTests, SameAsRangeTree) {
+    statistics_ s, t;
+    range_tree<2> reference(0.7, s);
+    zorder_index<> index(t, 16);
+    mt19937 gen(42);
+    // Clusters of points around a few centers.
+    uniform_int_distribution<int_least32_t> center(-100000, 100000);
+    normal_distribution<double> offset(0, 300);
+    vector<array<int_least32_t, 2>> centers(8);
+    for (auto &c : centers)
+        c = {center(gen), center(gen)};
+    for (int i = 0; i < 4000; ++i) {
+        const auto &c = centers[size_t(i) % centers.size()];
+        int_least32_t x = c[0] + int_least32_t(offset(gen)), y = c[1] + int_least32_t(offset(gen));
+        reference.insert(x, y);
+        index.insert(x, y);
+    }
+    EXPECT_EQ(index.size(), 4000);
+    for (int i = 0; i < 500; ++i) {
+        const auto &c = centers[size_t(i) % centers.size()];
+        int_least32_t x1 = c[0] + int_least32_t(offset(gen)), y1 = c[1] + int_least32_t(offset(gen));
+        int_least32_t x2 = x1 + int_least32_t(abs(offset(gen))), y2 = y1 + int_least32_t(abs(offset(gen)));
+        EXPECT_EQ(index.range_query(x1, y1, x2, y2), reference.range_query(x1, y1, x2, y2));
+    }
+    const int_least32_t low = numeric_limits<int_least32_t>::min(), high = numeric_limits<int_least32_t>::max();
+    EXPECT_EQ(index.range_query(low, low, high, high), 4000);
+    EXPECT_EQ(index.range_query(0, low, high, high), reference.range_query(0, low, high, high));
+    EXPECT_EQ(index.range_query(1, 1, 0, 0), 0);
+    EXPECT_GT(t.range_count_visits, 0u);
+
+    zorder_index<> built(t);
+    vector<zorder_index<>::point_type> points{{low, low}, {high, high}, {-1, 0}, {0, -1}, {-1, 0}};
+    built.build(points);
+    EXPECT_EQ(built.range_query(low, low, high, high), 5);
+    EXPECT_EQ(built.range_query(-1, 0, -1, 0), 2);
+    EXPECT_EQ(built.range_query(low, low, -1, -1), 1);
+    built.clear();
+    EXPECT_EQ(built.range_query(low, low, high, high), 0);
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,48 @@
+#include <string>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/*
+ * Print a trace for main.cpp to the standard output. For every element
+ * count, a run "# N" inserts N distinct keys in random order, followed by
+ * finds of keys drawn from the Zipf distribution -- the key of rank k is
+ * searched with probability proportional to 1 / k^exponent. Ranks are
+ * given to the keys at random, so popular keys are spread over the tree.
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Arguments -- Zipf exponent [finds per element] [element count...]." << endl;
+        throw 1;
+    }
+    const double exponent = stod(argv[1]);
+    const size_t finds_per_element = (argc > 2) ? size_t(stoul(argv[2])) : 10;
+    vector<size_t> counts;
+    for (int i = 3; i < argc; ++i)
+        counts.push_back(size_t(stoul(argv[i])));
+    if (counts.empty())
+        counts = {1000, 10000, 100000, 1000000};
+
+    mt19937 gen(2018);
+    for (auto n : counts) {
+        vector<int_least32_t> keys(n);
+        iota(keys.begin(), keys.end(), 0);
+        shuffle(keys.begin(), keys.end(), gen);
+        cout << "# " << n << "\n";
+        for (auto k : keys)
+            cout << "I " << k << "\n";
+
+        vector<double> weights(n);
+        for (size_t k = 0; k < n; ++k)
+            weights[k] = 1 / pow(double(k + 1), exponent);
+        discrete_distribution<size_t> rank(weights.begin(), weights.end());
+        for (size_t i = 0; i < n * finds_per_element; ++i)
+            cout << "F " << keys[rank(gen)] << "\n";
+        cerr << "RUN " << n << " FINISHED!" << endl;
+    }
+}
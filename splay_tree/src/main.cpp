@@ -0,0 +1,139 @@
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include "splay_tree.h"
+#include "optimal_tree.h"
+
+using namespace st;
+using namespace std;
+
+template<typename Out>
+void split(const string &s, const char& delimiter, Out&& result) {
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, delimiter)) {
+        if (!item.empty())
+            *(result++) = item;
+    }
+}
+
+vector<string> split(const string &s, const char& delimiter) {
+    vector<string> elems;
+    split(s, delimiter, back_inserter(elems));
+    return elems;
+}
+
+void print_stats(ofstream& ofs, const statistics_& stats) {
+    ofs << stats.max_range_count_visits << " ";
+    ofs << (stats.range_count_calls ? float(stats.range_count_visits) / stats.range_count_calls : 1) << " ";
+    ofs << stats.max_insert_visits << " ";
+    ofs << (stats.insert_calls ? float(stats.insert_visits) / stats.insert_calls : 1) << " ";
+}
+
+/*
+ * Finds of the run replayed on the optimal tree of its keys, weighted by
+ * how many times each key was searched. Only the finds are counted, the
+ * tree is built afterwards.
+ */
+void replay_optimal(ofstream& ofs, const map<int_least32_t, uint_least64_t> &frequencies,
+                    const vector<int_least32_t> &finds) {
+    vector<int_least32_t> keys;
+    vector<uint_least64_t> weights;
+    for (const auto &kv : frequencies) {
+        keys.push_back(kv.first);
+        weights.push_back(kv.second);
+    }
+    statistics_ s;
+    optimal_tree<int_least32_t> tree(s);
+    tree.build(keys, weights);
+    for (auto x : finds)
+        tree.find(x);
+    ofs << s.max_range_count_visits << " ";
+    ofs << (s.range_count_calls ? float(s.range_count_visits) / s.range_count_calls : 1) << " ";
+}
+
+/*
+ * Replay a trace of runs on the splay tree, BB[alpha] tree and the optimal
+ * static tree. A run starts by "# N", then come inserts "I x" and finds
+ * "F x". Range count columns of the output are the find visits.
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cout << "One argument -- output file name." << endl;
+        throw 1;
+    }
+    string line;
+    size_t last_n = 0;
+    volatile auto first = true;
+    ofstream ofs{ argv[1] };
+
+    statistics_ s1;
+    statistics_ s2;
+
+    splay_tree<int_least32_t> splay(s1);
+    rt::bbalpha<int_least32_t> alpha(0.7, s2);
+    // Searches of every inserted key and all finds in order, for the optimal tree.
+    map<int_least32_t, uint_least64_t> frequencies;
+    vector<int_least32_t> finds;
+
+    uint tree_count = 1;
+
+    ofs << "#N splay_max_find splay_mean_find splay_max_ins splay_mean_ins " << \
+              "bbalpha_max_find bbalpha_mean_find bbalpha_max_ins bbalpha_mean_ins " << \
+              "optimal_max_find optimal_mean_find" << endl;
+
+    auto finish_run = [&]() {
+        ofs << last_n << " ";
+        print_stats(ofs, s1);
+        print_stats(ofs, s2);
+        replay_optimal(ofs, frequencies, finds);
+        ofs << endl;
+        cout << "TREE " << tree_count << " FINISHED!" << endl;
+        ++tree_count;
+    };
+
+    while (!getline(cin, line).eof()) {
+        auto tokens = split(line, ' ');
+        if (tokens.empty())
+            continue;
+
+        if (tokens[0] == string("#")) {
+            if (!first)
+                finish_run();
+            // reset counters
+            s1.reset();
+            s2.reset();
+            // prepare next run
+            last_n = size_t(stoi(tokens[1]));
+            splay.clear();
+            alpha.clear();
+            frequencies.clear();
+            finds.clear();
+            first = false;
+        }
+        else if (tokens[0] == string("I")) {
+            auto x = stoi(tokens[1]);
+            if (splay.insert(x)) {
+                alpha.insert(x);
+                alpha.statistics(true, true);
+                frequencies.emplace(x, 0);
+            }
+        }
+        else { // if (tokens[0] == string("F")) {
+            auto x = stoi(tokens[1]);
+            splay.find(x);
+            alpha.find(x);
+            auto it = frequencies.find(x);
+            if (it != frequencies.end())
+                ++it->second;
+            finds.push_back(x);
+        }
+    }
+    // Print last statistics.
+    if (!first)
+        finish_run();
+    cout << "END OF INPUT" << endl;
+}
@@ -0,0 +1,220 @@
+#ifndef DATA_STRUCTURES_OPTIMAL_TREE_H
+#define DATA_STRUCTURES_OPTIMAL_TREE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include "../../range_tree/src/bbalpha_tree.h"
+
+namespace st {
+
+    using rt::statistics_;
+
+    /*
+     * Static binary search tree over known keys with known access weights.
+     * Node i holds the i-th smallest key, children are node indices. Finds
+     * are counted as range count visits, like in splay_tree.
+     */
+    template<typename T, typename Compare = std::less<>>
+    class optimal_tree {
+    public:
+        struct node {
+            T key;
+            int_least32_t left;
+            int_least32_t right;
+        };
+
+        // Up to this many keys build takes the exact O(n^2) time and space algorithm.
+        static constexpr size_t knuth_limit = 2048;
+
+        statistics_ &stats;
+
+        explicit optimal_tree(statistics_ &s) : stats(s) {}
+
+        int_least32_t size() const noexcept { return int_least32_t(nodes_.size()); }
+
+        int_least32_t root() const noexcept { return root_; }
+
+        const node &at(const int_least32_t i) const noexcept { return nodes_[size_t(i)]; }
+
+        /*
+         * Build the tree of increasing keys, key i searched weights[i] times.
+         * Exact up to knuth_limit keys, approximate above.
+         */
+        void build(const std::vector<T> &keys, const std::vector<uint_least64_t> &weights) {
+            if (keys.size() <= knuth_limit)
+                build_knuth(keys, weights);
+            else
+                build_approximate(keys, weights);
+        }
+
+        /*
+         * Tree with the least cost by dynamic programming over intervals of
+         * keys. The optimal root of an interval lies between the roots of
+         * the interval without its last and without its first key (Knuth),
+         * which brings the time down to O(n^2). Takes 12 n^2 bytes meanwhile.
+         */
+        void build_knuth(const std::vector<T> &keys, const std::vector<uint_least64_t> &weights) {
+            check(keys, weights);
+            const size_t n = keys.size(), m = n + 1;
+            std::vector<uint_least64_t> prefix(m, 0);
+            for (size_t i = 0; i < n; ++i)
+                prefix[i + 1] = prefix[i] + weights[i];
+            // Interval [i, j) is at i * m + j, the empty ones cost nothing.
+            std::vector<uint_least64_t> cost(m * m, 0);
+            std::vector<int_least32_t> roots(m * m, 0);
+            for (size_t i = 0; i < n; ++i) {
+                cost[i * m + i + 1] = weights[i];
+                roots[i * m + i + 1] = int_least32_t(i);
+            }
+            for (size_t length = 2; length <= n; ++length) {
+                for (size_t i = 0, j = length; j <= n; ++i, ++j) {
+                    uint_least64_t best = std::numeric_limits<uint_least64_t>::max();
+                    int_least32_t best_root = 0;
+                    for (int_least32_t r = roots[i * m + j - 1]; r <= roots[(i + 1) * m + j]; ++r) {
+                        const uint_least64_t c = cost[i * m + size_t(r)] + cost[size_t(r + 1) * m + j];
+                        if (c < best) {
+                            best = c;
+                            best_root = r;
+                        }
+                    }
+                    cost[i * m + j] = best + prefix[j] - prefix[i];
+                    roots[i * m + j] = best_root;
+                }
+            }
+            assemble(keys, [&roots, m](size_t i, size_t j) { return size_t(roots[i * m + j]); });
+        }
+
+        /*
+         * Nearly optimal tree by bisection (Mehlhorn) -- the root of an
+         * interval is the key splitting its weight most evenly. Its cost is
+         * at most W (H + 2) for entropy H of the weights, O(n log n) time.
+         * Every key gets a tiny extra weight, so keys never searched form
+         * balanced subtrees instead of paths.
+         */
+        void build_approximate(const std::vector<T> &keys, const std::vector<uint_least64_t> &weights) {
+            check(keys, weights);
+            const size_t n = keys.size();
+            // Twice the prefix sums of the weights, each key weighing n + 1 times more plus one.
+            std::vector<uint_least64_t> prefix(n + 1, 0);
+            for (size_t i = 0; i < n; ++i)
+                prefix[i + 1] = prefix[i] + weights[i] * (n + 1) + 1;
+            assemble(keys, [&prefix](size_t i, size_t j) {
+                // Weight left of r minus weight right of r grows with r.
+                auto balance = [&](size_t r) {
+                    return int_least64_t(prefix[r] + prefix[r + 1]) - int_least64_t(prefix[i] + prefix[j]);
+                };
+                size_t lo = i, hi = j - 1;
+                while (lo < hi) {
+                    const size_t mid = lo + (hi - lo) / 2;
+                    if (balance(mid) < 0)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                if (lo > i && -balance(lo - 1) < balance(lo))
+                    --lo;
+                return lo;
+            });
+        }
+
+        /*
+         * Splay-free search, return whether key is in the tree.
+         */
+        bool find(const T &key) {
+            int_least32_t i = root_;
+            bool found = false;
+            while (i >= 0) {
+                stats.record(false, false);
+                const node &n = nodes_[size_t(i)];
+                if (less(key, n.key)) {
+                    i = n.left;
+                } else if (less(n.key, key)) {
+                    i = n.right;
+                } else {
+                    found = true;
+                    break;
+                }
+            }
+            stats.record(false, true);
+            return found;
+        }
+
+        /*
+         * Sum of weights[i] times the number of nodes on the path to key i.
+         */
+        uint_least64_t cost(const std::vector<uint_least64_t> &weights) const {
+            uint_least64_t total = 0;
+            std::vector<std::pair<int_least32_t, uint_least64_t>> stack;
+            if (root_ >= 0)
+                stack.emplace_back(root_, 1);
+            while (!stack.empty()) {
+                const auto top = stack.back();
+                stack.pop_back();
+                const node &n = nodes_[size_t(top.first)];
+                total += weights[size_t(top.first)] * top.second;
+                if (n.left >= 0)
+                    stack.emplace_back(n.left, top.second + 1);
+                if (n.right >= 0)
+                    stack.emplace_back(n.right, top.second + 1);
+            }
+            return total;
+        }
+
+    private:
+        std::vector<node> nodes_;
+        int_least32_t root_ = -1;
+
+        static bool less(const T &a, const T &b) noexcept {
+            return Compare()(a, b);
+        }
+
+        static void check(const std::vector<T> &keys, const std::vector<uint_least64_t> &weights) {
+            if (keys.size() != weights.size())
+                throw std::invalid_argument("Every key needs its weight.");
+            if (keys.size() > size_t(std::numeric_limits<int_least32_t>::max()))
+                throw std::invalid_argument("Too many keys.");
+            for (size_t i = 1; i < keys.size(); ++i) {
+                if (!less(keys[i - 1], keys[i]))
+                    throw std::invalid_argument("Keys must be increasing.");
+            }
+        }
+
+        /*
+         * Link the nodes, root_of(i, j) gives the root of keys [i, j). An
+         * explicit stack, as trees of skewed weights may be deep.
+         */
+        template<typename RootOf>
+        void assemble(const std::vector<T> &keys, RootOf &&root_of) {
+            nodes_.clear();
+            nodes_.reserve(keys.size());
+            for (const T &k : keys)
+                nodes_.push_back({k, -1, -1});
+            root_ = -1;
+            struct interval {
+                size_t begin, end;
+                int_least32_t *link;
+            };
+            std::vector<interval> stack;
+            if (!keys.empty())
+                stack.push_back({0, keys.size(), &root_});
+            while (!stack.empty()) {
+                const interval top = stack.back();
+                stack.pop_back();
+                const size_t r = root_of(top.begin, top.end);
+                *top.link = int_least32_t(r);
+                if (top.begin < r)
+                    stack.push_back({top.begin, r, &nodes_[r].left});
+                if (r + 1 < top.end)
+                    stack.push_back({r + 1, top.end, &nodes_[r].right});
+            }
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_OPTIMAL_TREE_H
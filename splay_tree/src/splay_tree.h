@@ -0,0 +1,193 @@
+#ifndef DATA_STRUCTURES_SPLAY_TREE_H
+#define DATA_STRUCTURES_SPLAY_TREE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+#include "../../range_tree/src/bbalpha_tree.h"
+
+namespace st {
+
+    // The statistics of range_tree, so that visits of the trees compare directly.
+    using rt::statistics_;
+
+    /*
+     * Top-down splay tree (Sleator and Tarjan) of distinct values. Every
+     * access splays the searched value -- on the way down, nodes smaller
+     * than it are hung to the left tree and larger ones to the right tree,
+     * pairs of steps in one direction are rotated first. The last node of
+     * the path becomes the root, with the two trees as its subtrees.
+     * Frequently accessed values thus stay near the root.
+     *
+     * Nodes on the search path are counted as visits, insert visits for
+     * insert and range count visits for find.
+     */
+    template<typename T, typename Compare = std::less<>>
+    class splay_tree {
+    public:
+        class node;
+
+        struct links {
+            node *left = nullptr;
+            node *right = nullptr;
+        };
+
+        class node : public links {
+        public:
+            T value;
+
+            explicit node(const T &v) : value(v) {}
+            node(const node &other) = delete;
+            node &operator=(const node &other) = delete;
+        };
+
+        statistics_ &stats;
+
+        explicit splay_tree(statistics_ &s) : stats(s) {}
+        splay_tree(const splay_tree &other) = delete;
+        splay_tree &operator=(const splay_tree &other) = delete;
+
+        ~splay_tree() {
+            clear();
+        }
+
+        int_least32_t size() const noexcept { return size_; }
+
+        node *root() const noexcept { return root_; }
+
+        /*
+         * Delete all nodes without recursion -- a left child is rotated up
+         * until the root has none, then the root goes.
+         */
+        void clear() noexcept {
+            while (root_) {
+                node *l = root_->left;
+                if (l) {
+                    root_->left = l->right;
+                    l->right = root_;
+                    root_ = l;
+                } else {
+                    node *r = root_->right;
+                    delete root_;
+                    root_ = r;
+                }
+            }
+            size_ = 0;
+        }
+
+        /*
+         * Insert value and make it the root. Return false and only splay the
+         * equal value if there is one.
+         */
+        bool insert(const T &value) {
+            bool inserted = true;
+            if (!root_) {
+                root_ = new node(value);
+                ++size_;
+                stats.record(true, false);
+            } else {
+                splay(value, true);
+                if (less(value, root_->value)) {
+                    node *n = new node(value);
+                    n->left = root_->left;
+                    n->right = root_;
+                    root_->left = nullptr;
+                    root_ = n;
+                    ++size_;
+                } else if (less(root_->value, value)) {
+                    node *n = new node(value);
+                    n->right = root_->right;
+                    n->left = root_;
+                    root_->right = nullptr;
+                    root_ = n;
+                    ++size_;
+                } else {
+                    inserted = false;
+                }
+            }
+            stats.record(true, true);
+            return inserted;
+        }
+
+        /*
+         * Splay value, return whether it is in the tree (at the root then).
+         */
+        bool find(const T &value) {
+            bool found = false;
+            if (root_) {
+                splay(value, false);
+                found = !less(value, root_->value) && !less(root_->value, value);
+            }
+            stats.record(false, true);
+            return found;
+        }
+
+    private:
+        node *root_ = nullptr;
+        int_least32_t size_ = 0;
+
+        static bool less(const T &a, const T &b) noexcept {
+            return Compare()(a, b);
+        }
+
+        /*
+         * Top-down splay, the tree must not be empty. Nodes larger than
+         * value are linked as left children along the leftmost path of
+         * the right tree, smaller ones symmetrically.
+         */
+        void splay(const T &value, const bool insert) noexcept {
+            links header;
+            links *l = &header, *r = &header;
+            node *t = root_;
+            for (;;) {
+                stats.record(insert, false);
+                if (less(value, t->value)) {
+                    if (!t->left)
+                        break;
+                    if (less(value, t->left->value)) {
+                        // Rotate right.
+                        stats.record(insert, false);
+                        node *y = t->left;
+                        t->left = y->right;
+                        y->right = t;
+                        t = y;
+                        if (!t->left)
+                            break;
+                    }
+                    // Link right.
+                    r->left = t;
+                    r = t;
+                    t = t->left;
+                } else if (less(t->value, value)) {
+                    if (!t->right)
+                        break;
+                    if (less(t->right->value, value)) {
+                        // Rotate left.
+                        stats.record(insert, false);
+                        node *y = t->right;
+                        t->right = y->left;
+                        y->left = t;
+                        t = y;
+                        if (!t->right)
+                            break;
+                    }
+                    // Link left.
+                    l->right = t;
+                    l = t;
+                    t = t->right;
+                } else {
+                    break;
+                }
+            }
+            // Assemble.
+            l->right = t->left;
+            r->left = t->right;
+            t->left = header.right;
+            t->right = header.left;
+            root_ = t;
+        }
+    };
+
+}
+
+#endif //DATA_STRUCTURES_SPLAY_TREE_H
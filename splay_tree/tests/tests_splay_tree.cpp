@@ -0,0 +1,162 @@
+#include "../src/splay_tree.h"
+#include "../src/optimal_tree.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <set>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace st;
+
+// Keys of the subtree of n in ascending order.
+template<typename Node>
+void collect(const Node *n, vector<int> &out) {
+    if (!n)
+        return;
+    collect(n->left, out);
+    out.push_back(n->value);
+    collect(n->right, out);
+}
+
+TEST(SplayTreeTests, AgainstSet) {
+    statistics_ s;
+    splay_tree<int> tree(s);
+    set<int> reference;
+    mt19937 gen(44);
+    uniform_int_distribution<int> value(0, 999);
+    for (int i = 0; i < 5000; ++i) {
+        const int x = value(gen);
+        if (i % 3) {
+            EXPECT_EQ(tree.insert(x), reference.insert(x).second);
+        } else {
+            EXPECT_EQ(tree.find(x), reference.count(x) == 1);
+        }
+        ASSERT_EQ(tree.size(), int_least32_t(reference.size()));
+    }
+    vector<int> values;
+    collect(tree.root(), values);
+    EXPECT_TRUE(equal(values.begin(), values.end(), reference.begin(), reference.end()));
+    EXPECT_EQ(s.insert_calls + s.range_count_calls, 5000u);
+}
+
+TEST(SplayTreeTests, SplaysToRoot) {
+    statistics_ s;
+    splay_tree<int> tree(s);
+    // Increasing inserts make a left path, finding its bottom halves the depth.
+    for (int i = 0; i < 1024; ++i)
+        tree.insert(i);
+    EXPECT_EQ(tree.root()->value, 1023);
+    s.reset();
+    EXPECT_TRUE(tree.find(0));
+    EXPECT_EQ(tree.root()->value, 0);
+    EXPECT_EQ(s.max_range_count_visits, 1024u);
+    EXPECT_TRUE(tree.find(0));
+    EXPECT_EQ(s.range_count_visits, 1025u);
+    EXPECT_FALSE(tree.find(5000));
+    EXPECT_EQ(tree.root()->value, 1023);
+    s.reset();
+    EXPECT_TRUE(tree.find(1));
+    EXPECT_LT(s.max_range_count_visits, 600u);
+}
+
+// Cost of the optimal tree of weights[i, j) by the plain O(n^3) recurrence.
+uint_least64_t brute_force_cost(const vector<uint_least64_t> &weights) {
+    const size_t n = weights.size();
+    vector<vector<uint_least64_t>> cost(n + 1, vector<uint_least64_t>(n + 1, 0));
+    for (size_t length = 1; length <= n; ++length) {
+        for (size_t i = 0, j = length; j <= n; ++i, ++j) {
+            uint_least64_t best = numeric_limits<uint_least64_t>::max(), sum = 0;
+            for (size_t r = i; r < j; ++r) {
+                best = min(best, cost[i][r] + cost[r + 1][j]);
+                sum += weights[r];
+            }
+            cost[i][j] = best + sum;
+        }
+    }
+    return cost[0][n];
+}
+
+TEST(OptimalTreeTests, Knuth) {
+    mt19937 gen(44);
+    uniform_int_distribution<uint_least64_t> weight(0, 100);
+    for (size_t n = 0; n < 60; n += 7) {
+        vector<int> keys(n);
+        vector<uint_least64_t> weights(n);
+        for (size_t i = 0; i < n; ++i) {
+            keys[i] = int(3 * i);
+            weights[i] = (i % 4) ? weight(gen) : weight(gen) * 50;
+        }
+        statistics_ s;
+        optimal_tree<int> tree(s);
+        tree.build_knuth(keys, weights);
+        ASSERT_EQ(tree.size(), int_least32_t(n));
+        EXPECT_EQ(tree.cost(weights), brute_force_cost(weights));
+        for (size_t i = 0; i < n; ++i)
+            EXPECT_TRUE(tree.find(keys[i]));
+        EXPECT_FALSE(tree.find(1));
+    }
+}
+
+TEST(OptimalTreeTests, Approximate) {
+    mt19937 gen(44);
+    const size_t n = 5000;
+    vector<int> keys(n);
+    vector<uint_least64_t> weights(n);
+    double total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = int(i);
+        // Zipf-like weights over shuffled keys, some never searched.
+        weights[i] = (i % 5 == 0) ? 0 : 1000000 / (1 + gen() % n);
+        total += double(weights[i]);
+    }
+    double entropy = 0;
+    for (auto w : weights) {
+        if (w)
+            entropy -= double(w) / total * log2(double(w) / total);
+    }
+    statistics_ s;
+    optimal_tree<int> tree(s);
+    tree.build(keys, weights);
+    ASSERT_EQ(tree.size(), int_least32_t(n));
+    EXPECT_LE(double(tree.cost(weights)), total * (entropy + 2));
+    for (size_t i = 0; i < n; ++i)
+        ASSERT_TRUE(tree.find(keys[i]));
+    // Keys never searched are still in balanced subtrees.
+    EXPECT_LT(s.max_range_count_visits, 40u);
+
+    // Not far from the exact one where both apply.
+    vector<int> few_keys(keys.begin(), keys.begin() + 500);
+    vector<uint_least64_t> few_weights(weights.begin(), weights.begin() + 500);
+    optimal_tree<int> exact(s), approximate(s);
+    exact.build_knuth(few_keys, few_weights);
+    approximate.build_approximate(few_keys, few_weights);
+    EXPECT_LE(exact.cost(few_weights), approximate.cost(few_weights));
+    EXPECT_LT(double(approximate.cost(few_weights)), 1.25 * double(exact.cost(few_weights)));
+}
+
+TEST(OptimalTreeTests, BBAlphaFind) {
+    statistics_ s;
+    rt::bbalpha<int> tree(0.7, s);
+    for (int i = 0; i < 1000; i += 2) {
+        tree.insert(i);
+        tree.statistics(true, true);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        auto n = tree.find(i);
+        if (i % 2) {
+            EXPECT_EQ(n, nullptr);
+        } else {
+            ASSERT_NE(n, nullptr);
+            EXPECT_EQ(n->value, i);
+        }
+    }
+    EXPECT_EQ(s.range_count_calls, 1000u);
+}
+
+int main(int argc, char *argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}